@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <chrono>
 #include <functional>
@@ -16,7 +17,13 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <limits>
 #include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
 
 using namespace std;
 
@@ -83,10 +90,161 @@ struct Counter {
     void reset() { samples = 0; sum = 0; }
 };
 
+// ------------------------------ Job System --------------------------------
+// Counts outstanding jobs. Jobs submitted with a counter decrement it when they finish; jobs
+// submitted with submitAfter() are held back until their dependency counter reaches zero.
+class JobCounter {
+public:
+    int value() const { return count.load(); }
+private:
+    friend class JobSystem;
+    atomic<int> count{0};
+    mutex m;
+    vector<pair<function<void()>, JobCounter*>> continuations;
+};
+
+// Work-stealing job system. Every worker owns a deque: it pushes and pops at the back, idle
+// workers steal from the front of the others. Threads that are not workers (the main thread)
+// push into a shared injector queue. wait() never blocks idly: the waiting thread executes
+// queued jobs until the counter drains, so jobs may wait on jobs they spawn.
+// With zero workers nothing runs until wait(), and then strictly in submission order on the
+// calling thread -- a deterministic single-threaded mode for debugging.
+class JobSystem {
+public:
+    explicit JobSystem(int workers) {
+        for (int i=0; i<=workers; ++i) queues.push_back(make_unique<Queue>()); // last one is the injector
+        for (int i=0; i<workers; ++i) threads.emplace_back([this, i]{ workerLoop(i); });
+    }
+    ~JobSystem() {
+        { lock_guard<mutex> lk(sleepMutex); stopping = true; }
+        sleepCv.notify_all();
+        for (auto &t : threads) t.join();
+    }
+    int workerCount() const { return (int)threads.size(); }
+    // 0 on non-worker threads, 1..workerCount() on workers: an index for per-thread scratch.
+    static int threadSlot() { return workerIndex + 1; }
+    void submit(function<void()> fn, JobCounter *counter = nullptr) {
+        if (counter) counter->count++;
+        push({ move(fn), counter });
+    }
+    // Runs fn once `dependency` has dropped to zero (immediately if it already has).
+    void submitAfter(JobCounter &dependency, function<void()> fn, JobCounter *counter = nullptr) {
+        if (counter) counter->count++;
+        {
+            lock_guard<mutex> lk(dependency.m);
+            if (dependency.count.load() > 0) { dependency.continuations.push_back({ move(fn), counter }); return; }
+        }
+        push({ move(fn), counter });
+    }
+    void wait(JobCounter &counter) {
+        while (counter.count.load() > 0) if (!runOne()) this_thread::yield();
+        lock_guard<mutex> lk(counter.m); // the last job may still be releasing the counter
+    }
+    // Executes one queued job on the calling thread; false if there was nothing to do.
+    bool runOne() {
+        Job job;
+        if (!pop(job)) return false;
+        execute(job);
+        return true;
+    }
+    // Splits [begin, end) into chunks of `grain` and calls fn(chunkBegin, chunkEnd) on each.
+    // Chunks are independent; the calling thread takes part and returns once all are done.
+    template<typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F &&fn) {
+        if (begin >= end) return;
+        grain = max<size_t>(grain, 1);
+        if (threads.empty() || end - begin <= grain) { for (size_t b=begin; b<end; b+=grain) fn(b, min(end, b+grain)); return; }
+        JobCounter done;
+        for (size_t b=begin+grain; b<end; b+=grain) { size_t e = min(end, b+grain); submit([&fn, b, e]{ fn(b, e); }, &done); }
+        fn(begin, min(end, begin+grain));
+        wait(done);
+    }
+private:
+    struct Job { function<void()> fn; JobCounter *counter = nullptr; };
+    struct Queue { mutex m; deque<Job> jobs; };
+    static thread_local int workerIndex; // -1 on non-worker threads
+    Queue& ownQueue() { return workerIndex >= 0 ? *queues[workerIndex] : *queues.back(); }
+    void push(Job job) {
+        Queue &q = ownQueue();
+        { lock_guard<mutex> lk(q.m); q.jobs.push_back(move(job)); }
+        queued++;
+        { lock_guard<mutex> lk(sleepMutex); }
+        sleepCv.notify_one();
+    }
+    bool pop(Job &out) {
+        int self = workerIndex >= 0 ? workerIndex : (int)queues.size()-1;
+        { // own queue: newest first, keeps the working set hot; oldest first without workers so
+          // the single-threaded mode runs jobs in submission order
+            Queue &q = *queues[self];
+            lock_guard<mutex> lk(q.m);
+            if (!q.jobs.empty() && threads.empty()) { out = move(q.jobs.front()); q.jobs.pop_front(); queued--; return true; }
+            if (!q.jobs.empty()) { out = move(q.jobs.back()); q.jobs.pop_back(); queued--; return true; }
+        }
+        for (size_t k=1; k<queues.size(); ++k) { // steal the oldest job from someone else
+            Queue &q = *queues[(self + k) % queues.size()];
+            lock_guard<mutex> lk(q.m);
+            if (!q.jobs.empty()) { out = move(q.jobs.front()); q.jobs.pop_front(); queued--; return true; }
+        }
+        return false;
+    }
+    void execute(Job &job) {
+        job.fn();
+        if (!job.counter) return;
+        vector<pair<function<void()>, JobCounter*>> ready;
+        {
+            lock_guard<mutex> lk(job.counter->m); // decrement under the lock so submitAfter sees a consistent count
+            if (--job.counter->count == 0) ready.swap(job.counter->continuations);
+        }
+        for (auto &c : ready) push({ move(c.first), c.second });
+    }
+    void workerLoop(int index) {
+        workerIndex = index;
+        for (;;) {
+            if (runOne()) continue;
+            unique_lock<mutex> lk(sleepMutex);
+            sleepCv.wait(lk, [this]{ return stopping || queued.load() > 0; });
+            if (stopping) return;
+        }
+    }
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> threads;
+    atomic<int> queued{0};
+    mutex sleepMutex;
+    condition_variable sleepCv;
+    bool stopping = false;
+};
+thread_local int JobSystem::workerIndex = -1;
+
+// ------------------------------ Triple Buffer -----------------------------
+// Lock-free hand-off of whole values from one producer thread to one consumer thread. The
+// producer fills back() and publish() trades it for the shared middle slot; acquire() trades
+// the consumer's front slot for the middle one if something newer was published. Neither side
+// ever waits: the producer may overwrite values the consumer never saw, and the consumer always
+// reads the latest complete one. Slots are reused, so containers inside T keep their capacity.
+template<typename T>
+class TripleBuffer {
+public:
+    T& back() { return slots[backIdx]; }
+    void publish() { backIdx = middle.exchange(uint8_t(backIdx | Fresh), memory_order_acq_rel) & IndexMask; }
+    // True if front() changed. front() stays valid (and unchanged) until the next acquire().
+    bool acquire() {
+        if (!(middle.load(memory_order_relaxed) & Fresh)) return false;
+        frontIdx = middle.exchange(frontIdx, memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+    const T& front() const { return slots[frontIdx]; }
+private:
+    enum : uint8_t { IndexMask = 3, Fresh = 4 };
+    T slots[3];
+    uint8_t backIdx = 0, frontIdx = 1;
+    atomic<uint8_t> middle{2};
+};
+
 // ------------------------------ Resources ---------------------------------
 struct Texture {
     SDL_Texture* tex = nullptr;
     int w=0,h=0;
+    uint32_t loadOrder = 0; // set by ResourceManager; sprites in one layer draw grouped by it
     Texture(SDL_Texture* t=nullptr,int ww=0,int hh=0):tex(t),w(ww),h(hh){}
     ~Texture(){ if(tex) SDL_DestroyTexture(tex); }
 };
@@ -108,7 +266,7 @@ public:
         if (!surf) { LOGW("Failed to load texture %s: %s", path.c_str(), IMG_GetError()); return nullptr; }
         SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surf);
         if (!tex) { LOGE("SDL_CreateTextureFromSurface failed: %s", SDL_GetError()); SDL_FreeSurface(surf); return nullptr; }
-        auto t = make_shared<Texture>(tex, surf->w, surf->h);
+        auto t = make_shared<Texture>(tex, surf->w, surf->h); t->loadOrder = nextLoadOrder++;
         SDL_FreeSurface(surf);
         textures[id]=t;
         LOGI("Loaded texture '%s' (%s) %dx%d", id.c_str(), path.c_str(), t->w, t->h);
@@ -134,45 +292,710 @@ private:
     SDL_Renderer* renderer = nullptr;
     unordered_map<string, shared_ptr<Texture>> textures;
     unordered_map<string, shared_ptr<Sound>> sounds;
+    uint32_t nextLoadOrder = 0;
     bool audioEnabled = true;
 };
 
+// ------------------------------ Fixed Point -------------------------------
+// Physics scalar. Float results drift with compiler and flags (FMA contraction, x87, fast-math),
+// which rules out lockstep multiplayer and bit-exact replays. Building with ENGINE_FIXED_POINT
+// switches positions, velocities, collider sizes and all collision math to Q16.16 integers, so
+// a step produces the same bits everywhere. Range is about +/-32768 px in 1/65536 px steps.
+struct Fixed {
+    static constexpr int Shift = 16;
+    static constexpr int32_t One = 1 << Shift;
+    int32_t raw = 0;
+    Fixed() {}
+    template<typename I, typename enable_if<is_integral<I>::value, int>::type = 0>
+    Fixed(I v):raw((int32_t)v * One){}
+    Fixed(double v):raw((int32_t)llround(v * One)){}
+    Fixed(float v):Fixed((double)v){}
+    static Fixed fromRaw(int32_t r) { Fixed f; f.raw = r; return f; }
+    explicit operator float() const { return (float)raw / One; }
+    explicit operator double() const { return (double)raw / One; }
+    // out of range wraps (as the SIMD kernels do) rather than being UB, so even a body that
+    // fell off the world stays deterministic
+    friend Fixed operator+(Fixed a, Fixed b) { return fromRaw((int32_t)((uint32_t)a.raw + (uint32_t)b.raw)); }
+    friend Fixed operator-(Fixed a, Fixed b) { return fromRaw((int32_t)((uint32_t)a.raw - (uint32_t)b.raw)); }
+    friend Fixed operator*(Fixed a, Fixed b) { return fromRaw((int32_t)(((int64_t)a.raw * b.raw) >> Shift)); }
+    // saturates instead of wrapping: sweep and slab tests divide small gaps by tiny velocities
+    friend Fixed operator/(Fixed a, Fixed b) {
+        if (b.raw == 0) return fromRaw(a.raw < 0 ? INT32_MIN : INT32_MAX);
+        int64_t q = (int64_t)a.raw * One / b.raw;
+        return fromRaw((int32_t)max<int64_t>(INT32_MIN, min<int64_t>(INT32_MAX, q)));
+    }
+    Fixed operator-() const { return fromRaw((int32_t)(0u - (uint32_t)raw)); }
+    Fixed& operator+=(Fixed o) { return *this = *this + o; }
+    Fixed& operator-=(Fixed o) { return *this = *this - o; }
+    Fixed& operator*=(Fixed o) { return *this = *this * o; }
+    Fixed& operator/=(Fixed o) { return *this = *this / o; }
+    friend bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+    friend bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+    friend bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+static inline float toFloat(float v) { return v; }
+static inline float toFloat(Fixed v) { return (float)v; }
+static inline float pabs(float v) { return fabsf(v); }
+static inline Fixed pabs(Fixed v) { return v.raw < 0 ? -v : v; }
+// floor(v / d) for a cell size d, e.g. which tile column a coordinate falls in.
+static inline int floorDiv(float v, int d) { return (int)floorf(v / d); }
+// |(vx,vy)| <= limit without a square root; the fixed version squares in 64 bits since any speed
+// over ~181 px/s overflows Q16.16 once squared.
+static inline bool speedWithin(float vx, float vy, float limit) { return vx*vx + vy*vy <= limit*limit; }
+static inline bool speedWithin(Fixed vx, Fixed vy, Fixed limit) {
+    auto sq = [](Fixed v){ return (uint64_t)((int64_t)v.raw * v.raw); };
+    return sq(vx) + sq(vy) <= sq(limit);
+}
+static inline int floorDiv(Fixed v, int d) { int64_t q = (int64_t)d * Fixed::One; return (int)(v.raw >= 0 ? v.raw / q : -((q - 1 - v.raw) / q)); }
+
+#ifdef ENGINE_FIXED_POINT
+using preal = Fixed;
+static const preal PrealMax = Fixed::fromRaw(INT32_MAX);
+#else
+using preal = float;
+static const preal PrealMax = numeric_limits<float>::infinity();
+#endif
+static_assert(sizeof(preal) == 4, "physics columns are hashed and streamed as 32-bit lanes");
+
 // ------------------------------ ECS ---------------------------------------
-struct Component { virtual ~Component(){} };
-struct Transform : public Component { float x=0,y=0,rot=0,sx=1,sy=1; };
-struct Sprite : public Component { string tex=""; int sx=0,sy=0,sw=0,sh=0; bool centered=true; float layer=0; };
-struct Animation { int frameCount=1; float frameTime=0.1f; bool loop=true; int current=0; double timer=0; }; 
-struct AnimatedSprite : public Sprite { Animation anim; };
-struct Physics : public Component { float vx=0,vy=0,ax=0,ay=0,mass=1.0f,gravity=900.0f; bool onGround=false; };
-struct Collider : public Component { float w=16,h=16,offx=0,offy=0; bool isStatic=false; };
-struct Script : public Component { function<void(int,double)> onUpdate; function<void(int)> onStart; };
-struct CameraComp : public Component { float lerp=0.12f, zoom=1.0f; };
-struct UIComp : public Component { string text=""; int fontID=0; };
+// Entity handle: slot index + generation. Destroying an entity bumps the slot's generation,
+// so old handles go stale instead of aliasing whatever reuses the slot. gen 0 is never live.
+struct Entity {
+    uint32_t index = 0, gen = 0;
+    uint64_t id() const { return ((uint64_t)gen << 32) | index; }
+    bool operator==(const Entity &o) const { return index==o.index && gen==o.gen; }
+    bool operator!=(const Entity &o) const { return !(*this==o); }
+};
+
+// Pool allocator backing component storage. Elements live in fixed-size, cache-line aligned
+// chunks that are never reallocated, so growing a pool does not move existing components.
+// Chunks emptied by removals go to a free list and are reused before new memory is requested.
+struct PoolStats {
+    const char* name = "";
+    size_t live = 0;        // components in use
+    size_t capacity = 0;    // element slots in chunks holding live data
+    size_t chunks = 0;      // chunks in use
+    size_t freeChunks = 0;  // empty chunks kept for reuse
+    size_t bytes = 0;       // total memory reserved, free chunks included
+    float occupancy() const { return capacity ? (float)live/capacity : 1.0f; }
+    // Pools are kept packed (swap-remove), so there are no interior holes; what can pile up
+    // is idle chunks on the free list. Reported as their share of the reserved memory.
+    float fragmentation() const { size_t total = chunks + freeChunks; return total ? (float)freeChunks/total : 0.0f; }
+};
+
+template<typename T>
+class ChunkedStorage {
+public:
+    static constexpr size_t ChunkShift = 8, ChunkSize = size_t(1) << ChunkShift, ChunkMask = ChunkSize-1;
+    static constexpr size_t ChunkAlign = alignof(T) > 64 ? alignof(T) : 64;
+    ChunkedStorage() {}
+    ChunkedStorage(const ChunkedStorage&) = delete;
+    ChunkedStorage& operator=(const ChunkedStorage&) = delete;
+    ~ChunkedStorage() { clear(); freeList.insert(freeList.end(), chunks.begin(), chunks.end()); chunks.clear(); trim(); }
+    T& operator[](size_t i) { return chunks[i >> ChunkShift][i & ChunkMask]; }
+    const T& operator[](size_t i) const { return chunks[i >> ChunkShift][i & ChunkMask]; }
+    T& back() { return (*this)[count-1]; }
+    T* chunk(size_t c) { return chunks[c]; } // ChunkSize contiguous elements
+    size_t size() const { return count; }
+    size_t capacity() const { return chunks.size() * ChunkSize; }
+    T& push_back(const T &v) {
+        if (count == capacity()) chunks.push_back(acquireChunk());
+        T* slot = &chunks[count >> ChunkShift][count & ChunkMask];
+        new (slot) T(v);
+        count++;
+        return *slot;
+    }
+    void pop_back() {
+        count--;
+        (*this)[count].~T();
+        // keep one spare chunk past the end to avoid thrashing at a chunk boundary
+        if (chunks.size()*ChunkSize - count > ChunkSize + ChunkSize/2) { freeList.push_back(chunks.back()); chunks.pop_back(); }
+    }
+    void reserve(size_t n) { while (capacity() < n) chunks.push_back(acquireChunk()); }
+    void clear() { while (count) pop_back(); }
+    void trim() { for (T* c : freeList) ::operator delete(c, align_val_t(ChunkAlign)); freeList.clear(); }
+    void stats(PoolStats &st) const {
+        st.live = count; st.capacity = capacity(); st.chunks = chunks.size(); st.freeChunks = freeList.size();
+        st.bytes = (chunks.size() + freeList.size()) * ChunkSize * sizeof(T);
+    }
+private:
+    T* acquireChunk() {
+        if (!freeList.empty()) { T* c = freeList.back(); freeList.pop_back(); return c; }
+        return static_cast<T*>(::operator new(ChunkSize * sizeof(T), align_val_t(ChunkAlign)));
+    }
+    vector<T*> chunks;
+    vector<T*> freeList;
+    size_t count = 0;
+};
+
+// Structure-of-arrays components. The field list is written once and expands to
+//  - T:        plain value struct, used to add() the component;
+//  - TRef:     struct of references into the columns, returned (wrapped in RefPtr) by get();
+//  - TColumns: one ChunkedStorage per field. Columns share the chunk layout, so a chunk
+//              index gives aligned, contiguous runs of every field for SIMD kernels.
+#define SOA_VALUE(type, name, def) type name = def;
+#define SOA_REF(type, name, def) type &name;
+#define SOA_REF_INIT(type, name, def) name[i],
+#define SOA_COLUMN(type, name, def) ChunkedStorage<type> name;
+#define SOA_COPY_OUT(type, name, def) v.name = name;
+#define SOA_COPY_IN(type, name, def) name = v.name;
+#define SOA_PUSH(type, name, def) name.push_back(v.name);
+#define SOA_POP(type, name, def) name.pop_back();
+#define SOA_ASSIGN(type, name, def) name[dst] = name[src];
+#define SOA_SWAP(type, name, def) swap(name[i], name[j]);
+#define SOA_RESERVE(type, name, def) name.reserve(n);
+#define SOA_TRIM(type, name, def) name.trim();
+// every column holds the same elements in the same number of chunks, so live/capacity are
+// per component while chunk counts and bytes add up across columns
+#define SOA_STATS(type, name, def) { PoolStats c; name.stats(c); st.bytes += c.bytes; st.chunks += c.chunks; st.freeChunks += c.freeChunks; st.capacity = c.capacity; st.live = c.live; }
+
+#define DECLARE_SOA_COMPONENT(T, FIELDS) \
+    struct T { FIELDS(SOA_VALUE) }; \
+    struct T##Ref { \
+        FIELDS(SOA_REF) \
+        operator T() const { T v; FIELDS(SOA_COPY_OUT) return v; } \
+        T##Ref& operator=(const T &v) { FIELDS(SOA_COPY_IN) return *this; } \
+    }; \
+    struct T##Columns { \
+        FIELDS(SOA_COLUMN) \
+        T##Ref ref(size_t i) { return T##Ref{ FIELDS(SOA_REF_INIT) }; } \
+        void push(const T &v) { FIELDS(SOA_PUSH) } \
+        void pop() { FIELDS(SOA_POP) } \
+        void assign(size_t dst, size_t src) { FIELDS(SOA_ASSIGN) } \
+        void swapAt(size_t i, size_t j) { FIELDS(SOA_SWAP) } \
+        void reserve(size_t n) { FIELDS(SOA_RESERVE) } \
+        void trim() { FIELDS(SOA_TRIM) } \
+        void stats(PoolStats &st) const { st.bytes = st.chunks = st.freeChunks = 0; FIELDS(SOA_STATS) } \
+    };
+
+// Pointer-like wrapper around an optional TRef so SoA lookups read like T* lookups:
+// `auto tr = world->get<Transform>(e); if(tr) tr->x += 1;`
+template<typename R>
+class RefPtr {
+public:
+    RefPtr() {}
+    RefPtr(const R &r):ref(r){}
+    explicit operator bool() const { return ref.has_value(); }
+    R* operator->() { return &*ref; }
+    const R* operator->() const { return &*ref; }
+    R& operator*() { return *ref; }
+private:
+    optional<R> ref;
+};
+
+// Physics state is preal (float, or Q16.16 with ENGINE_FIXED_POINT); rot/scale only affect rendering.
+#define TRANSFORM_FIELDS(F) F(preal, x, 0) F(preal, y, 0) F(float, rot, 0) F(float, sx, 1) F(float, sy, 1)
+#define PHYSICS_FIELDS(F) F(preal, vx, 0) F(preal, vy, 0) F(preal, ax, 0) F(preal, ay, 0) F(preal, mass, 1.0f) F(preal, gravity, 900.0f) F(bool, onGround, false) \
+                          F(bool, canSleep, true) F(preal, restTime, 0)
+DECLARE_SOA_COMPONENT(Transform, TRANSFORM_FIELDS)
+DECLARE_SOA_COMPONENT(Physics, PHYSICS_FIELDS)
+
+// `texture` caches the lookup of `tex` (owned by ResourceManager); reset textureResolved after
+// changing tex. Sprites draw in increasing layer order.
+struct Sprite { string tex=""; int sx=0,sy=0,sw=0,sh=0; bool centered=true; float layer=0; Texture *texture=nullptr; bool textureResolved=false; };
+struct Animation { int frameCount=1; float frameTime=0.1f; bool loop=true; int current=0; double timer=0; };
+// Collision layers: two colliders interact only if each one's category is in the other's mask.
+enum : uint32_t { LayerDefault = 1u<<0, LayerTiles = 1u<<1, LayerPlayer = 1u<<2, LayerCollectible = 1u<<3, LayerAll = 0xFFFFFFFFu };
+static bool layersInteract(uint32_t catA, uint32_t maskA, uint32_t catB, uint32_t maskB){ return (catA & maskB) && (catB & maskA); }
+// ccd: sweep against static geometry, for fast bodies. trigger: never resolved, only reports
+// overlap events (Engine::onTriggerEvents).
+struct Collider { preal w=16,h=16,offx=0,offy=0; bool isStatic=false; bool ccd=false; bool trigger=false; uint32_t category=LayerDefault, mask=LayerAll; };
+struct Script { function<void(Entity,double)> onUpdate; function<void(Entity)> onStart; };
+struct CameraComp { float lerp=0.12f, zoom=1.0f; };
+struct UIComp { string text=""; int fontID=0; };
+
+// Component registry: every component struct gets a dense compile-time id used to index
+// World's pool table. The string names are only for tooling and serialization.
+#define ENGINE_COMPONENTS(X) \
+    X(Transform, "transform") X(Sprite, "sprite") X(Animation, "animation") X(Physics, "physics") \
+    X(Collider, "collider") X(Script, "script") X(CameraComp, "camera") X(UIComp, "ui")
+
+enum ComponentTypeId {
+#define X(T, N) T##Id,
+    ENGINE_COMPONENTS(X)
+#undef X
+    ComponentTypeCount
+};
+
+template<typename T> struct ComponentType; // undefined for anything that is not a registered component
+#define X(T, N) template<> struct ComponentType<T> { static constexpr int id = T##Id; };
+ENGINE_COMPONENTS(X)
+#undef X
+
+static const char* const componentNames[ComponentTypeCount] = {
+#define X(T, N) N,
+    ENGINE_COMPONENTS(X)
+#undef X
+};
+
+using ComponentMask = uint32_t;
+static_assert(ComponentTypeCount <= 32, "ComponentMask has one bit per component type");
+
+template<typename... Ts>
+static constexpr ComponentMask componentMask() { return (ComponentMask(0) | ... | (ComponentMask(1) << ComponentType<Ts>::id)); }
+
+static int componentIdByName(const string &name) {
+    for (int i=0; i<ComponentTypeCount; ++i) if (name == componentNames[i]) return i;
+    return -1;
+}
+
+// Sparse-set storage: each component type lives in its own pool, packed densely so systems
+// can walk the data linearly. sparse[slot] -> index into dense/items, -1 if absent. dense keeps
+// the full handle, so a lookup with a stale generation misses.
+class IComponentPool {
+public:
+    virtual ~IComponentPool(){}
+    virtual bool has(Entity e) const = 0;
+    virtual void* getRaw(Entity e) = 0;
+    // Copy the component out to / in from a caller-owned T; false if the entity lacks it.
+    virtual bool copyOut(Entity e, void *out) = 0;
+    virtual bool copyIn(Entity e, const void *in) = 0;
+    virtual void remove(Entity e) = 0;
+    virtual void reserve(size_t n) = 0;
+    virtual size_t size() const = 0;
+    virtual void stats(PoolStats &st) const = 0;
+    virtual void trim() = 0;
+    virtual int indexOf(Entity e) const = 0; // dense position, -1 if absent
+    virtual void swapDense(size_t i, size_t j) = 0;
+};
+
+template<typename T>
+class ComponentPool : public IComponentPool {
+public:
+    bool has(Entity e) const override { return e.index<sparse.size() && sparse[e.index]>=0 && dense[sparse[e.index]]==e; }
+    T* get(Entity e) { return has(e) ? &items[sparse[e.index]] : nullptr; }
+    void* getRaw(Entity e) override { return get(e); }
+    bool copyOut(Entity e, void *out) override { T *c = get(e); if (!c) return false; *static_cast<T*>(out) = *c; return true; }
+    bool copyIn(Entity e, const void *in) override { T *c = get(e); if (!c) return false; *c = *static_cast<const T*>(in); return true; }
+    T& ref(Entity e) { return items[sparse[e.index]]; }
+    T& add(Entity e, const T &comp) {
+        if (has(e)) { items[sparse[e.index]] = comp; return items[sparse[e.index]]; }
+        if (e.index >= sparse.size()) sparse.resize(e.index+1, -1);
+        sparse[e.index] = (int)dense.size();
+        dense.push_back(e);
+        return items.push_back(comp);
+    }
+    void remove(Entity e) override { // swap with the last element to keep the arrays packed
+        if (!has(e)) return;
+        int idx = sparse[e.index], last = (int)dense.size()-1;
+        if (idx != last) { dense[idx] = dense[last]; items[idx] = move(items[last]); sparse[dense[idx].index] = idx; }
+        dense.pop_back(); items.pop_back(); sparse[e.index] = -1;
+    }
+    void reserve(size_t n) override { dense.reserve(n); items.reserve(n); }
+    size_t size() const override { return dense.size(); }
+    void stats(PoolStats &st) const override { items.stats(st); }
+    void trim() override { items.trim(); }
+    int indexOf(Entity e) const override { return has(e) ? sparse[e.index] : -1; }
+    void swapDense(size_t i, size_t j) override {
+        if (i == j) return;
+        swap(dense[i], dense[j]); swap(items[i], items[j]);
+        sparse[dense[i].index] = (int)i; sparse[dense[j].index] = (int)j;
+    }
+    const vector<Entity>& entities() const { return dense; }
+    // Component at dense position i, matching entities()[i].
+    T& at(size_t i) { return items[i]; }
+private:
+    vector<int> sparse;
+    vector<Entity> dense;
+    ChunkedStorage<T> items;
+};
+
+// Sparse set over SoA columns. get() returns a RefPtr instead of a T*; kernels can reach the
+// raw columns through columns().
+template<typename T, typename Columns, typename Ref>
+class SoAComponentPool : public IComponentPool {
+public:
+    bool has(Entity e) const override { return e.index<sparse.size() && sparse[e.index]>=0 && dense[sparse[e.index]]==e; }
+    RefPtr<Ref> get(Entity e) { return has(e) ? RefPtr<Ref>(cols.ref(sparse[e.index])) : RefPtr<Ref>(); }
+    void* getRaw(Entity /*e*/) override { return nullptr; } // columnar: no addressable struct, use get<T>() or copyOut/copyIn
+    bool copyOut(Entity e, void *out) override { if (!has(e)) return false; *static_cast<T*>(out) = cols.ref(sparse[e.index]); return true; }
+    bool copyIn(Entity e, const void *in) override { if (!has(e)) return false; Ref r = cols.ref(sparse[e.index]); r = *static_cast<const T*>(in); return true; }
+    Ref ref(Entity e) { return cols.ref(sparse[e.index]); }
+    Ref add(Entity e, const T &comp) {
+        if (has(e)) { Ref r = cols.ref(sparse[e.index]); r = comp; return r; }
+        if (e.index >= sparse.size()) sparse.resize(e.index+1, -1);
+        sparse[e.index] = (int)dense.size();
+        dense.push_back(e);
+        cols.push(comp);
+        return cols.ref(dense.size()-1);
+    }
+    void remove(Entity e) override {
+        if (!has(e)) return;
+        int idx = sparse[e.index], last = (int)dense.size()-1;
+        if (idx != last) { dense[idx] = dense[last]; cols.assign(idx, last); sparse[dense[idx].index] = idx; }
+        dense.pop_back(); cols.pop(); sparse[e.index] = -1;
+    }
+    void reserve(size_t n) override { dense.reserve(n); cols.reserve(n); }
+    size_t size() const override { return dense.size(); }
+    void stats(PoolStats &st) const override { cols.stats(st); }
+    void trim() override { cols.trim(); }
+    int indexOf(Entity e) const override { return has(e) ? sparse[e.index] : -1; }
+    void swapDense(size_t i, size_t j) override {
+        if (i == j) return;
+        swap(dense[i], dense[j]); cols.swapAt(i, j);
+        sparse[dense[i].index] = (int)i; sparse[dense[j].index] = (int)j;
+    }
+    const vector<Entity>& entities() const { return dense; }
+    Ref at(size_t i) { return cols.ref(i); }
+    Columns& columns() { return cols; }
+private:
+    vector<int> sparse;
+    vector<Entity> dense;
+    Columns cols;
+};
+
+template<typename T> struct PoolFor { using type = ComponentPool<T>; };
+template<> struct PoolFor<Transform> { using type = SoAComponentPool<Transform, TransformColumns, TransformRef>; };
+template<> struct PoolFor<Physics> { using type = SoAComponentPool<Physics, PhysicsColumns, PhysicsRef>; };
+template<typename T> using PoolType = typename PoolFor<T>::type;
+
+// Cached match set for one component mask: exactly the live entities owning every component
+// in the mask, kept up to date by World on add/remove/destroy.
+struct EntityGroup {
+    ComponentMask mask = 0;
+    vector<Entity> dense;
+    vector<int> sparse; // slot -> index into dense, -1 if not a member
+    void insert(Entity e) {
+        if (e.index >= sparse.size()) sparse.resize(e.index+1, -1);
+        sparse[e.index] = (int)dense.size(); dense.push_back(e);
+    }
+    void erase(Entity e) {
+        if (e.index >= sparse.size() || sparse[e.index] < 0) return;
+        int idx = sparse[e.index];
+        dense[idx] = dense.back(); sparse[dense[idx].index] = idx;
+        dense.pop_back(); sparse[e.index] = -1;
+    }
+};
+
+class World;
+
+// Iterates only the entities that own all of Ts. Cheap to create: it points at a cached group.
+template<typename... Ts>
+class View {
+public:
+    View(World &w, EntityGroup &g):world(w),group(g){}
+    vector<Entity>::const_iterator begin() const { return group.dense.begin(); }
+    vector<Entity>::const_iterator end() const { return group.dense.end(); }
+    size_t size() const { return group.dense.size(); }
+    bool empty() const { return group.dense.empty(); }
+    Entity operator[](size_t i) const { return group.dense[i]; }
+    // fn(Entity, Ts&...). Indexed so the callback may add/remove other components safely.
+    template<typename F> void each(F &&fn);
+private:
+    World &world;
+    EntityGroup &group;
+};
 
 class World {
 public:
-    World():nextId(1){}
-    int create() { int id = nextId++; entities.push_back(id); return id; }
-    void destroy(int id){ // naive
-        entities.erase(remove(entities.begin(), entities.end(), id), entities.end());
-        components.erase(id);
+    World(){
+#define X(T, N) pools[T##Id] = make_unique<PoolType<T>>();
+        ENGINE_COMPONENTS(X)
+#undef X
+    }
+    // O(1): pops a recycled slot from the free list or appends a new one.
+    Entity create() { Entity e = reserve(); activate(e); return e; }
+    // Hands out a handle without making it live. Touches neither the entity list nor any pool,
+    // so it is safe while systems iterate; CommandBuffer activates the handle at flush.
+    Entity reserve() {
+        uint32_t idx;
+        if (!freeSlots.empty()) { idx = freeSlots.back(); freeSlots.pop_back(); }
+        else { idx = (uint32_t)generations.size(); generations.push_back(1); denseIndex.push_back(-1); masks.push_back(0); }
+        return Entity{idx, generations[idx]};
+    }
+    void activate(Entity e) {
+        if (e.index>=generations.size() || generations[e.index]!=e.gen || denseIndex[e.index]>=0) return;
+        masks[e.index] = 0;
+        denseIndex[e.index] = (int)entities.size();
+        entities.push_back(e);
+    }
+    // O(1) in the entity count: swap-removes from the dense list and recycles the slot.
+    void destroy(Entity e){
+        if (!alive(e)) return;
+        for (auto &g : groups) if ((masks[e.index] & g->mask) == g->mask) g->erase(e);
+        unpackBody(e);
+        for (auto &p : pools) p->remove(e);
+        masks[e.index] = 0; ++structureVersion;
+        int di = denseIndex[e.index];
+        Entity last = entities.back();
+        entities[di] = last; denseIndex[last.index] = di;
+        entities.pop_back(); denseIndex[e.index] = -1;
+        // a slot whose generation would wrap is retired instead of reused, so handles never repeat
+        if (++generations[e.index] != 0) freeSlots.push_back(e.index);
+    }
+    bool alive(Entity e) const { return e.index<generations.size() && generations[e.index]==e.gen && denseIndex[e.index]>=0; }
+    // Returns T& for plain components and a TRef for SoA ones.
+    template<typename T>
+    decltype(auto) add(Entity e, const T &comp) {
+        pool<T>().add(e, comp);
+        setMask(e, masks[e.index] | componentMask<T>());
+        packBody(e);
+        return pool<T>().ref(e);
     }
     template<typename T>
-    void add(int id, const string &name, shared_ptr<T> comp) { components[id][name] = comp; }
+    void remove(Entity e) { removeById(e, ComponentType<T>::id); }
+    // Returns nullptr (an empty RefPtr for SoA components) when the entity lacks the component
+    // or the handle is stale. Only valid until the next add/remove on the same pool.
+    template<typename T>
+    auto get(Entity e) { return pool<T>().get(e); }
+    template<typename T>
+    bool has(Entity e) const { return pools[ComponentType<T>::id]->has(e); }
     template<typename T>
-    shared_ptr<T> get(int id, const string &name) {
-        auto it = components.find(id);
-        if (it==components.end()) return nullptr;
-        auto it2 = it->second.find(name);
-        if (it2==it->second.end()) return nullptr;
-        return static_pointer_cast<T>(it2->second);
-    }
-    vector<int>& all() { return entities; }
-    unordered_map<int, unordered_map<string, shared_ptr<Component>>> &allComps() { return components; }
+    PoolType<T>& pool() { return *static_cast<PoolType<T>*>(pools[ComponentType<T>::id].get()); }
+    // Structural changes must go through World (add/remove/destroy) so cached groups stay valid.
+    template<typename T>
+    const PoolType<T>& pool() const { return *static_cast<const PoolType<T>*>(pools[ComponentType<T>::id].get()); }
+    // Entities owning both Transform and Physics occupy dense positions [0, bodyCount()) of
+    // both pools, in the same order, so integration can stream the columns side by side.
+    // Within that prefix the awake bodies come first: [0, awakeBodyCount()).
+    size_t bodyCount() const { return packedBodies; }
+    size_t awakeBodyCount() const { return awakeBodies; }
+    // Changes with every add/remove/destroy and every reorder of the body prefix (sleep/wake), so
+    // caches built from the entity set or the body order know when to rebuild.
+    uint64_t version() const { return structureVersion; }
+    bool asleep(Entity e) const { return (masks[e.index] & BodyMask) == BodyMask && pools[TransformId]->indexOf(e) >= (int)awakeBodies; }
+    // Sleeping bodies are skipped by integration and resolution. Anything that changes a
+    // sleeping body's velocity from outside the physics step must wake it first.
+    // Both reorder the Transform/Physics pools, so refs obtained from get() become invalid.
+    void sleep(Entity e) {
+        if (!alive(e) || (masks[e.index] & BodyMask) != BodyMask || asleep(e)) return;
+        moveBody(pools[TransformId]->indexOf(e), --awakeBodies);
+    }
+    void wake(Entity e) {
+        if (!alive(e) || !asleep(e)) return;
+        moveBody(pools[TransformId]->indexOf(e), awakeBodies++);
+    }
+    // The first call for a given component set builds its group by scanning the smallest pool;
+    // afterwards the group is maintained incrementally and the view is O(1) to obtain.
+    template<typename... Ts>
+    View<Ts...> view() {
+        constexpr ComponentMask m = componentMask<Ts...>();
+        lock_guard<mutex> lk(groupsMutex); // systems running in parallel may ask for views concurrently
+        for (auto &g : groups) if (g->mask == m) return View<Ts...>(*this, *g);
+        groups.push_back(make_unique<EntityGroup>());
+        EntityGroup &g = *groups.back(); g.mask = m;
+        const IComponentPool* smallest = nullptr;
+        for (const IComponentPool* p : { static_cast<const IComponentPool*>(&pool<Ts>())... }) if (!smallest || p->size() < smallest->size()) smallest = p;
+        for (Entity e : entities) if ((masks[e.index] & m) == m && smallest->has(e)) g.insert(e);
+        return View<Ts...>(*this, g);
+    }
+    // Visit every (entity, component) pair of one pool in dense order.
+    template<typename T, typename F>
+    void each(F &&fn) {
+        auto &p = pool<T>();
+        for (size_t i=0; i<p.size(); ++i) fn(p.entities()[i], p.at(i));
+    }
+    // Name-based access for tooling/serialization; gameplay code should use the typed API.
+    // getByName returns nullptr for the columnar components (Transform, Physics), which have no
+    // addressable struct; read/writeByName copy through a caller-owned value and cover every type.
+    void* getByName(Entity e, const string &name) { int t = componentIdByName(name); return t<0 ? nullptr : pools[t]->getRaw(e); }
+    bool readByName(Entity e, const string &name, void *out) { int t = componentIdByName(name); return t>=0 && pools[t]->copyOut(e, out); }
+    bool writeByName(Entity e, const string &name, const void *in) { int t = componentIdByName(name); return t>=0 && pools[t]->copyIn(e, in); }
+    void removeByName(Entity e, const string &name) { int t = componentIdByName(name); if (t>=0) removeById(e, t); }
+    void removeById(Entity e, int type) {
+        if (!pools[type]->has(e)) return;
+        if (type == TransformId || type == PhysicsId) unpackBody(e);
+        setMask(e, masks[e.index] & ~(ComponentMask(1) << type));
+        pools[type]->remove(e);
+    }
+    // Capacity hints for batched structural changes.
+    void reserveEntities(size_t n) { entities.reserve(n); }
+    void reserveComponents(int type, size_t n) { pools[type]->reserve(n); }
+    size_t componentCount(int type) const { return pools[type]->size(); }
+    // Occupancy/fragmentation of every component pool, indexed by ComponentTypeId.
+    void poolStats(vector<PoolStats> &out) const {
+        out.resize(ComponentTypeCount);
+        for (int t=0; t<ComponentTypeCount; ++t) { out[t] = PoolStats(); out[t].name = componentNames[t]; pools[t]->stats(out[t]); }
+    }
+    // Returns free chunks to the system, e.g. after unloading a level.
+    void trimPools() { for (auto &p : pools) p->trim(); }
+    const vector<Entity>& all() const { return entities; }
+private:
+    void setMask(Entity e, ComponentMask m) {
+        ComponentMask old = masks[e.index];
+        for (auto &g : groups) {
+            bool was = (old & g->mask) == g->mask, now = (m & g->mask) == g->mask;
+            if (!was && now) g->insert(e); else if (was && !now) g->erase(e);
+        }
+        masks[e.index] = m; ++structureVersion;
+    }
+    static constexpr ComponentMask BodyMask = componentMask<Transform, Physics>();
+    // Swaps two positions of the body prefix in both pools.
+    void moveBody(size_t from, size_t to) {
+        pools[TransformId]->swapDense(from, to);
+        pools[PhysicsId]->swapDense(from, to);
+        ++structureVersion;
+    }
+    // Moves a fresh Transform+Physics owner to the end of the awake part of the prefix.
+    void packBody(Entity e) {
+        if ((masks[e.index] & BodyMask) != BodyMask || pools[TransformId]->indexOf(e) < (int)packedBodies) return;
+        pools[TransformId]->swapDense(pools[TransformId]->indexOf(e), packedBodies);
+        pools[PhysicsId]->swapDense(pools[PhysicsId]->indexOf(e), packedBodies);
+        moveBody(packedBodies++, awakeBodies++);
+    }
+    // Moves a body out of the packed prefix before it loses Transform or Physics.
+    void unpackBody(Entity e) {
+        if ((masks[e.index] & BodyMask) != BodyMask) return;
+        size_t at = pools[TransformId]->indexOf(e);
+        if (at < awakeBodies) { size_t lastAwake = --awakeBodies; moveBody(at, lastAwake); at = lastAwake; }
+        moveBody(at, --packedBodies);
+    }
+    size_t packedBodies = 0, awakeBodies = 0;
+    uint64_t structureVersion = 0;
+    vector<Entity> entities;     // live handles, packed
+    vector<int> denseIndex;      // slot -> position in entities, -1 when free
+    vector<uint32_t> generations; // slot -> current generation
+    vector<uint32_t> freeSlots;
+    vector<ComponentMask> masks;  // slot -> components owned
+    unique_ptr<IComponentPool> pools[ComponentTypeCount];
+    vector<unique_ptr<EntityGroup>> groups;
+    mutex groupsMutex;
+};
+
+template<typename... Ts>
+template<typename F>
+void View<Ts...>::each(F &&fn) {
+    for (size_t i=0; i<group.dense.size(); ++i) { Entity e = group.dense[i]; fn(e, *world.get<Ts>(e)...); }
+}
+
+// Records create/destroy/add/remove while systems iterate the World and applies them in
+// order at a sync point (flush). Component payloads are staged per type so flush can size
+// every affected pool once before applying the batch.
+class CommandBuffer {
+public:
+    CommandBuffer() {
+#define X(T, N) staging[T##Id] = make_unique<Staging<T>>();
+        ENGINE_COMPONENTS(X)
+#undef X
+    }
+    // The handle is valid immediately (it can be passed to add()), but the entity only
+    // becomes live when the buffer is flushed.
+    Entity create(World &w) { Entity e = w.reserve(); cmds.push_back({ Command::Create, -1, e, 0 }); creates++; return e; }
+    void destroy(Entity e) { cmds.push_back({ Command::Destroy, -1, e, 0 }); }
+    template<typename T>
+    void add(Entity e, const T &comp) {
+        auto &st = static_cast<Staging<T>&>(*staging[ComponentType<T>::id]);
+        cmds.push_back({ Command::Add, ComponentType<T>::id, e, (uint32_t)st.items.size() });
+        st.items.push_back(comp);
+    }
+    template<typename T>
+    void remove(Entity e) { cmds.push_back({ Command::Remove, ComponentType<T>::id, e, 0 }); }
+    bool empty() const { return cmds.empty(); }
+    void flush(World &w) {
+        if (cmds.empty()) return;
+        if (creates) w.reserveEntities(w.all().size() + creates);
+        for (int t=0; t<ComponentTypeCount; ++t) if (size_t n = staging[t]->count()) w.reserveComponents(t, w.componentCount(t) + n);
+        for (auto &c : cmds) {
+            switch (c.op) {
+                case Command::Create: w.activate(c.e); break;
+                case Command::Destroy: w.destroy(c.e); break;
+                case Command::Add: if (w.alive(c.e)) staging[c.type]->apply(w, c.e, c.payload); break;
+                case Command::Remove: w.removeById(c.e, c.type); break;
+            }
+        }
+        cmds.clear(); creates = 0;
+        for (auto &st : staging) st->clear();
+    }
+private:
+    struct Command { enum Op : uint8_t { Create, Destroy, Add, Remove } op; int type; Entity e; uint32_t payload; };
+    struct IStaging {
+        virtual ~IStaging(){}
+        virtual void apply(World &w, Entity e, uint32_t i) = 0;
+        virtual size_t count() const = 0;
+        virtual void clear() = 0;
+    };
+    template<typename T>
+    struct Staging : IStaging {
+        vector<T> items;
+        void apply(World &w, Entity e, uint32_t i) override { w.add(e, items[i]); }
+        size_t count() const override { return items.size(); }
+        void clear() override { items.clear(); }
+    };
+    vector<Command> cmds;
+    size_t creates = 0;
+    unique_ptr<IStaging> staging[ComponentTypeCount];
+};
+
+// ------------------------------ System Scheduler ---------------------------
+// Systems declare what they read and write; bits 0..31 are component types, the bits above
+// are engine resources that are not components. Two systems conflict when one writes
+// something the other touches. Conflicting systems run in registration order, everything
+// else may run concurrently as jobs.
+using AccessMask = uint64_t;
+enum ResourceId { ResourceParticles = 32, ResourceWorldStructure, ResourceAudio };
+static constexpr AccessMask AccessAll = ~AccessMask(0);
+
+template<typename... Ts>
+static constexpr AccessMask access() { return componentMask<Ts...>(); }
+static constexpr AccessMask resourceAccess(ResourceId r) { return AccessMask(1) << r; }
+
+struct SystemDesc {
+    string name;
+    AccessMask reads = 0, writes = 0;
+    bool mainThread = false; // must run on the thread calling SystemScheduler::run
+    function<void(double)> run;
+};
+
+class SystemScheduler {
+public:
+    explicit SystemScheduler(JobSystem &j):jobs(j){}
+    void add(SystemDesc desc) { systems.push_back({ move(desc) }); dirty = true; }
+    // Runs every system once. Returns when all of them have finished; meanwhile the calling
+    // thread runs main-thread systems and helps with queued jobs.
+    void run(double dt) {
+        if (dirty) buildGraph();
+        remaining = (int)systems.size();
+        for (auto &s : systems) s.pending = (int)s.deps;
+        for (size_t i=0; i<systems.size(); ++i) if (systems[i].deps == 0) launch((int)i, dt);
+        while (remaining.load() > 0) {
+            int next = -1;
+            { lock_guard<mutex> lk(m); if (!mainReady.empty()) { next = mainReady.front(); mainReady.pop_front(); } }
+            if (next >= 0) execute(next, dt);
+            else if (!jobs.runOne()) this_thread::yield();
+        }
+    }
+    // Average wall time per system, for profiling.
+    const Counter& timing(const string &name) const { static Counter none; for (auto &s : systems) if (s.desc.name == name) return s.time; return none; }
 private:
-    int nextId;
-    vector<int> entities;
-    unordered_map<int, unordered_map<string, shared_ptr<Component>>> components;
+    struct Node {
+        SystemDesc desc;
+        vector<int> dependents;
+        size_t deps = 0;
+        atomic<int> pending{0};
+        Counter time;
+        Node(SystemDesc d):desc(move(d)){}
+        Node(Node &&o):desc(move(o.desc)),dependents(move(o.dependents)),deps(o.deps),time(o.time){}
+    };
+    static bool conflicts(const SystemDesc &a, const SystemDesc &b) { return (a.writes & (b.reads|b.writes)) || (b.writes & a.reads); }
+    // Edge i -> j for every earlier system i that conflicts with j. Rebuilt only when the set changes.
+    void buildGraph() {
+        for (auto &s : systems) { s.dependents.clear(); s.deps = 0; }
+        for (size_t j=0; j<systems.size(); ++j)
+            for (size_t i=0; i<j; ++i)
+                if (conflicts(systems[i].desc, systems[j].desc)) { systems[i].dependents.push_back((int)j); systems[j].deps++; }
+        dirty = false;
+    }
+    void launch(int i, double dt) {
+        if (systems[i].desc.mainThread) { lock_guard<mutex> lk(m); mainReady.push_back(i); }
+        else jobs.submit([this, i, dt]{ execute(i, dt); });
+    }
+    void execute(int i, double dt) {
+        Node &s = systems[i];
+        double t0 = nowMillis();
+        s.desc.run(dt);
+        s.time.add(nowMillis() - t0);
+        for (int d : s.dependents) if (--systems[d].pending == 0) launch(d, dt);
+        remaining--;
+    }
+    JobSystem &jobs;
+    deque<Node> systems;
+    bool dirty = true;
+    atomic<int> remaining{0};
+    deque<int> mainReady;
+    mutex m;
 };
 
 // ------------------------------ Input -------------------------------------
@@ -208,12 +1031,13 @@ private:
 };
 
 // ------------------------------ Tilemap ----------------------------------
+struct TileRect { int col, row, cols, rows; }; // in cells
 class Tilemap {
 public:
     bool loadCSV(const string &path) {
         string txt = readFileAll(path);
         if(txt.empty()) return false;
-        data.clear(); rows=0; cols=0;
+        data.clear(); rows=0; cols=0; ++changes;
         istringstream iss(txt);
         string line;
         while(getline(iss,line)){
@@ -231,19 +1055,55 @@ public:
         return true;
     }
     int get(int r,int c) const { if(r<0||r>=rows||c<0||c>=cols) return 0; return data[r][c]; }
+    void set(int r,int c,int v) { if(r<0||r>=rows||c<0||c>=cols||data[r][c] == v) return; if(data[r][c] != 0 && v == 0) cleared.push_back({ c, r, 1, 1 }); data[r][c] = v; ++changes; }
+    void resize(int r,int c,int fill=0) { rows=r; cols=c; data.assign(r, vector<int>(c, fill)); cleared.clear(); ++changes; }
+    // Bumped by every edit of the grid, so a copy only needs refreshing when this moved on.
+    uint64_t version() const { return changes; }
+    // The grid row-major into out (resized to rows*cols).
+    void copyTo(vector<int> &out) const { out.resize((size_t)rows*cols); for(int r=0; r<rows; ++r) copy(data[r].begin(), data[r].end(), out.begin() + (size_t)r*cols); }
+    // Cells set() turned from solid to empty since the caller last cleared this; physics drains it
+    // to wake sleeping bodies that rested on them.
+    vector<TileRect>& clearedCells() { return cleared; }
+    // Any non-zero tile blocks movement; cell (r,c) covers [c*tileW, (c+1)*tileW) x [r*tileH, (r+1)*tileH).
+    bool solid(int r,int c) const { return get(r,c) != 0; }
+    // Greedy meshing: grow each unclaimed solid cell right as far as possible, then down while the
+    // whole span stays solid. Covers every solid cell exactly once with far fewer rectangles
+    // (a solid 20x4 block becomes one) and leaves no internal seams to snag on.
+    vector<TileRect> mergeSolid() const {
+        vector<TileRect> out; vector<char> used((size_t)rows*cols, 0);
+        auto avail = [&](int r,int c){ return solid(r,c) && !used[(size_t)r*cols + c]; };
+        for(int r=0; r<rows; ++r) for(int c=0; c<cols; ++c){
+            if(!avail(r,c)) continue;
+            int w = 1; while(c+w < cols && avail(r, c+w)) w++;
+            int h = 1; for(bool grow=true; grow && r+h < rows; ){ for(int i=0; i<w; ++i) if(!avail(r+h, c+i)) { grow=false; break; } if(grow) h++; }
+            for(int y=r; y<r+h; ++y) for(int x=c; x<c+w; ++x) used[(size_t)y*cols + x] = 1;
+            out.push_back({ c, r, w, h });
+        }
+        return out;
+    }
     int rows=0, cols=0;
+    int tileW=64, tileH=64;
 private:
     vector<vector<int>> data;
+    vector<TileRect> cleared;
+    uint64_t changes = 0;
 };
 
 // ------------------------------ Particles --------------------------------
-struct Particle { float x,y,vx,vy,life,age; };
+struct Particle { float x,y,vx,vy,life,age; float px,py; }; // px,py: position before the last update, for interpolation
 class ParticleSystem {
 public:
     ParticleSystem(int maxP=1024) { pool.resize(maxP); for(int i=0;i<maxP;i++) pool[i].age=1e9f; }
-    void emit(float x,float y,int n){ for(int i=0;i<n;i++){ int idx=findFree(); if(idx<0) break; auto &p=pool[idx]; p.x=x; p.y=y; float ang = ((float)rand()/RAND_MAX)*6.28318f; float sp = 50 + ((float)rand()/RAND_MAX)*200.0f; p.vx=cosf(ang)*sp; p.vy=sinf(ang)*sp; p.life = 300 + rand()%800; p.age=0; } }
-    void update(double dt){ for(auto &p:pool){ if(p.age < p.life){ p.age += dt*1000.0f; p.vy += 300.0f * dt; p.x += p.vx * dt; p.y += p.vy * dt; } } }
-    void render(SDL_Renderer* r, float camX, float camY){ for(auto &p:pool){ if(p.age < p.life){ float a = 1.0f - (p.age / p.life); SDL_SetRenderDrawColor(r, (Uint8)(255*a), (Uint8)(180*a), (Uint8)(80*a), 255); SDL_Rect rr = {(int)(p.x - camX), (int)(p.y - camY), 2,2}; SDL_RenderFillRect(r, &rr); } } }
+    void emit(float x,float y,int n){ for(int i=0;i<n;i++){ int idx=findFree(); if(idx<0) break; auto &p=pool[idx]; p.x=p.px=x; p.y=p.py=y; float ang = ((float)rand()/RAND_MAX)*6.28318f; float sp = 50 + ((float)rand()/RAND_MAX)*200.0f; p.vx=cosf(ang)*sp; p.vy=sinf(ang)*sp; p.life = 300 + rand()%800; p.age=0; } }
+    void update(double dt){ update(dt, 0, pool.size()); }
+    // Updates particles [begin, end); disjoint ranges may run on different threads.
+    void update(double dt, size_t begin, size_t end){ for(size_t i=begin;i<end;++i){ auto &p=pool[i]; if(p.age < p.life){ p.px = p.x; p.py = p.y; p.age += dt*1000.0f; p.vy += 300.0f * dt; p.x += p.vx * dt; p.y += p.vy * dt; } } }
+    size_t capacity() const { return pool.size(); }
+    // Copies the live particles, e.g. into a render snapshot.
+    void snapshot(vector<Particle> &out) const { out.clear(); for(auto &p:pool) if(p.age < p.life) out.push_back(p); }
+    // alpha blends from the previous update's position (0) to the current one (1).
+    static void render(SDL_Renderer* r, const vector<Particle> &live, float camX, float camY, float alpha = 1.0f){ for(auto &p:live){ if(p.age < p.life){ float a = 1.0f - (p.age / p.life); SDL_SetRenderDrawColor(r, (Uint8)(255*a), (Uint8)(180*a), (Uint8)(80*a), 255);
+        float x = alpha >= 1.0f ? p.x : p.px + (p.x - p.px)*alpha, y = alpha >= 1.0f ? p.y : p.py + (p.y - p.py)*alpha; SDL_Rect rr = {(int)(x - camX), (int)(y - camY), 2,2}; SDL_RenderFillRect(r, &rr); } } }
 private:
     int findFree(){ for(size_t i=0;i<pool.size();++i) if(pool[i].age >= pool[i].life) return (int)i; return -1; }
     vector<Particle> pool;
@@ -258,14 +1118,770 @@ public:
     void stopMusic(){ Mix_HaltMusic(); }
 };
 
+// ------------------------------ Collision ---------------------------------
+struct AABB { preal x,y,w,h; };
+static bool aabbIntersect(const AABB &a, const AABB &b){ return !(a.x+a.w < b.x || b.x+b.w < a.x || a.y+a.h < b.y || b.y+b.h < a.y); }
+
+// Time of impact of box a moving by (dx,dy) against a static box b, as a fraction of the move in
+// [0,1], plus the contact normal on a. Boxes that merely touch or already overlap don't count;
+// the discrete pass handles those.
+static bool sweepAABB(const AABB &a, preal dx, preal dy, const AABB &b, preal &toi, preal &nx, preal &ny){
+    preal enterX = -PrealMax, exitX = PrealMax, enterY = -PrealMax, exitY = PrealMax;
+    if (dx != 0) { preal t0 = (b.x - (a.x + a.w)) / dx, t1 = (b.x + b.w - a.x) / dx; enterX = min(t0, t1); exitX = max(t0, t1); }
+    else if (a.x + a.w <= b.x || b.x + b.w <= a.x) return false;
+    if (dy != 0) { preal t0 = (b.y - (a.y + a.h)) / dy, t1 = (b.y + b.h - a.y) / dy; enterY = min(t0, t1); exitY = max(t0, t1); }
+    else if (a.y + a.h <= b.y || b.y + b.h <= a.y) return false;
+    preal enter = max(enterX, enterY), exit = min(exitX, exitY);
+    if (enter >= exit || enter < 0.0f || enter > 1.0f) return false;
+    toi = enter; nx = ny = 0;
+    if (enterX > enterY) nx = dx > 0 ? -1.0f : 1.0f; else ny = dy > 0 ? -1.0f : 1.0f;
+    return true;
+}
+
+// One collider as seen by the broadphase this step.
+struct BroadphaseProxy { Entity id; AABB box; bool isStatic; uint32_t category, mask; };
+// Layer filter plus static-vs-static rejection; broadphases apply it before any box math.
+static bool proxiesInteract(const BroadphaseProxy &a, const BroadphaseProxy &b){ return !(a.isStatic && b.isStatic) && layersInteract(a.category, a.mask, b.category, b.mask); }
+// Candidate pair as indices into the proxy array, a < b.
+struct BroadphasePair { uint32_t a, b; };
+
+static void sortPairs(vector<BroadphasePair> &pairs){
+    sort(pairs.begin(), pairs.end(), [](const BroadphasePair &l, const BroadphasePair &r){ return l.a < r.a || (l.a == r.a && l.b < r.b); });
+}
+
+// Persistent overlap reported by broadphases that track pairs across steps.
+struct EntityPair { Entity a, b; };
+
+// Overlap of a trigger collider with a non-trigger one. Begin/End are reported on the step the
+// overlap starts/stops, Stay on every step in between; destroying either entity ends it.
+enum class TriggerPhase : uint8_t { Begin, Stay, End };
+struct TriggerEvent { TriggerPhase phase; Entity trigger, other; };
+
+// Spatial query filter: colliders whose category is outside `mask`, and `ignore`, are skipped.
+struct QueryFilter { uint32_t mask = LayerAll; Entity ignore{}; };
+struct RayHit { Entity entity; float t, x, y, nx, ny; }; // t in [0,1] along the segment; normal of the hit face
+
+// Segment o + d*t, t in [0,1], against a box (slab test). A segment starting inside hits at
+// t = 0 with a zero normal.
+static bool segmentAABB(float ox, float oy, float dx, float dy, const AABB &b, float &t, float &nx, float &ny){
+    float t0 = 0.0f, t1 = 1.0f; nx = ny = 0;
+    float o[2] = { ox, oy }, d[2] = { dx, dy }, lo[2] = { toFloat(b.x), toFloat(b.y) }, hi[2] = { toFloat(b.x + b.w), toFloat(b.y + b.h) };
+    for (int a=0; a<2; ++a) {
+        if (d[a] == 0) { if (o[a] < lo[a] || o[a] > hi[a]) return false; continue; }
+        float ta = (lo[a] - o[a]) / d[a], tb = (hi[a] - o[a]) / d[a]; float sign = -1.0f;
+        if (ta > tb) { swap(ta, tb); sign = 1.0f; }
+        if (ta > t0) { t0 = ta; nx = a == 0 ? sign : 0; ny = a == 1 ? sign : 0; }
+        t1 = min(t1, tb);
+        if (t0 > t1) return false;
+    }
+    t = t0; return true;
+}
+
+// Produces candidate pairs (a superset of the overlapping ones), each exactly once, sorted by
+// (a, b). The narrowphase filters them down to actual contacts.
+class Broadphase {
+public:
+    virtual ~Broadphase(){}
+    virtual const char* name() const = 0;
+    virtual void findPairs(const vector<BroadphaseProxy> &proxies, vector<BroadphasePair> &pairs) = 0;
+    // Appends the proxies (indices into the array given to the last findPairs) that may overlap
+    // `box`, each once. Backs the spatial queries between steps; must not allocate once `out`
+    // has grown to size.
+    virtual void queryBox(const AABB &box, vector<uint32_t> &out) = 0;
+};
+
+// Reference implementation: tests every pair.
+class NaiveBroadphase : public Broadphase {
+public:
+    const char* name() const override { return "naive"; }
+    void findPairs(const vector<BroadphaseProxy> &proxies, vector<BroadphasePair> &pairs) override {
+        pairs.clear();
+        for (uint32_t i=0; i<proxies.size(); ++i)
+            for (uint32_t j=i+1; j<proxies.size(); ++j)
+                if (proxiesInteract(proxies[i], proxies[j]) && aabbIntersect(proxies[i].box, proxies[j].box)) pairs.push_back({ i, j });
+        count = (uint32_t)proxies.size();
+    }
+    void queryBox(const AABB &, vector<uint32_t> &out) override { for (uint32_t i=0; i<count; ++i) out.push_back(i); }
+private:
+    uint32_t count = 0;
+};
+
+// Uniform grid / spatial hash. Every proxy is entered into each cell its box touches; proxies
+// sharing a cell become candidates. A pair overlapping several cells is reported only from the
+// first cell common to both (min corner of the intersection of their cell ranges), so there are
+// no duplicates and no pair set to dedup. Cost is O(cells touched + pairs per cell), so the cell
+// size should be around the size of a typical moving body.
+class GridBroadphase : public Broadphase {
+public:
+    explicit GridBroadphase(float cell):cellSize(max(cell, 1.0f)){}
+    const char* name() const override { return "grid"; }
+    void findPairs(const vector<BroadphaseProxy> &proxies, vector<BroadphasePair> &pairs) override {
+        pairs.clear(); entries.clear(); ranges.resize(proxies.size());
+        for (uint32_t i=0; i<proxies.size(); ++i) {
+            const AABB &b = proxies[i].box;
+            CellRange r = { cellOf(b.x), cellOf(b.y), cellOf(b.x + b.w), cellOf(b.y + b.h) };
+            ranges[i] = r;
+            for (int cy=r.y0; cy<=r.y1; ++cy) for (int cx=r.x0; cx<=r.x1; ++cx) entries.push_back({ cellKey(cx, cy), i });
+        }
+        sort(entries.begin(), entries.end(), [](const Entry &l, const Entry &r){ return l.key < r.key || (l.key == r.key && l.proxy < r.proxy); });
+        for (size_t s=0; s<entries.size(); ) {
+            size_t e = s; while (e < entries.size() && entries[e].key == entries[s].key) e++;
+            for (size_t i=s; i<e; ++i) for (size_t j=i+1; j<e; ++j) {
+                uint32_t a = entries[i].proxy, b = entries[j].proxy;
+                if (!proxiesInteract(proxies[a], proxies[b])) continue;
+                const CellRange &ra = ranges[a], &rb = ranges[b];
+                if (cellKey(max(ra.x0, rb.x0), max(ra.y0, rb.y0)) != entries[s].key) continue; // owned by another cell
+                pairs.push_back({ a, b });
+            }
+            s = e;
+        }
+        sortPairs(pairs);
+    }
+    // Same owner-cell rule as pairs: a proxy spanning several queried cells is reported from the
+    // first cell shared by its range and the query's. A box covering more cells than there are
+    // entries walks the entries instead, so huge query boxes cost O(entries) rather than O(area).
+    void queryBox(const AABB &box, vector<uint32_t> &out) override {
+        CellRange q = { cellOf(box.x), cellOf(box.y), cellOf(box.x + box.w), cellOf(box.y + box.h) };
+        if ((int64_t)(q.x1 - q.x0 + 1) * (q.y1 - q.y0 + 1) > (int64_t)entries.size()) {
+            for (const Entry &e: entries) {
+                int cx = (int)(uint32_t)(e.key >> 32), cy = (int)(uint32_t)e.key;
+                const CellRange &r = ranges[e.proxy];
+                if (cx >= q.x0 && cx <= q.x1 && cy >= q.y0 && cy <= q.y1 && max(r.x0, q.x0) == cx && max(r.y0, q.y0) == cy) out.push_back(e.proxy);
+            }
+            return;
+        }
+        for (int cy=q.y0; cy<=q.y1; ++cy) for (int cx=q.x0; cx<=q.x1; ++cx) {
+            uint64_t key = cellKey(cx, cy);
+            auto it = lower_bound(entries.begin(), entries.end(), key, [](const Entry &e, uint64_t k){ return e.key < k; });
+            for (; it != entries.end() && it->key == key; ++it) {
+                const CellRange &r = ranges[it->proxy];
+                if (max(r.x0, q.x0) == cx && max(r.y0, q.y0) == cy) out.push_back(it->proxy);
+            }
+        }
+    }
+private:
+    struct CellRange { int x0, y0, x1, y1; };
+    struct Entry { uint64_t key; uint32_t proxy; };
+    int cellOf(float v) const { return (int)floorf(v / cellSize); }
+    int cellOf(Fixed v) const { return (int)floor((double)v / cellSize); }
+    static uint64_t cellKey(int cx, int cy) { return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy; }
+    float cellSize;
+    vector<CellRange> ranges;
+    vector<Entry> entries;
+};
+
+// Dynamic AABB tree (incremental BVH). Leaves persist across steps, keyed by entity, and hold a
+// box fattened by `margin`, so a body that moves less than that needs no tree update at all.
+// Insertion descends by a surface-area heuristic (perimeter in 2D) and AVL-style rotations keep
+// the tree balanced. Unlike the grid it copes with wildly different collider sizes.
+class TreeBroadphase : public Broadphase {
+public:
+    explicit TreeBroadphase(float fatMargin):margin(max(fatMargin, 0.0f)){}
+    const char* name() const override { return "tree"; }
+    // Candidates are overlaps of the fat boxes, kept across steps as leaf pairs (Box2D's move
+    // buffer): only leaves reinserted this step (moved out of their fat box, new, or with changed
+    // filter bits) query the tree, and only their old pairs are dropped. A scene of mostly
+    // resting bodies then costs O(bodies + pairs) per step instead of a query per body.
+    void findPairs(const vector<BroadphaseProxy> &proxies, vector<BroadphasePair> &pairs) override {
+        pairs.clear(); ++stamp; moved.clear();
+        for (uint32_t i=0; i<proxies.size(); ++i) {
+            const BroadphaseProxy &p = proxies[i];
+            auto it = leaves.find(p.id.id()); int leaf;
+            if (it == leaves.end()) { leaf = allocNode(); nodes[leaf].box = fatten(p.box); insertLeaf(leaf); leaves.emplace(p.id.id(), leaf); moved.push_back(leaf); }
+            else {
+                leaf = it->second; Node &n = nodes[leaf];
+                if (!contains(n.box, p.box)) { removeLeaf(leaf); nodes[leaf].box = fatten(p.box); insertLeaf(leaf); moved.push_back(leaf); }
+                else if (n.isStatic != p.isStatic || n.category != p.category || n.mask != p.mask) moved.push_back(leaf);
+            }
+            Node &n = nodes[leaf]; n.proxy = i; n.stamp = stamp; n.isStatic = p.isStatic; n.category = p.category; n.mask = p.mask;
+        }
+        for (int leaf: moved) nodes[leaf].dirty = stamp;
+        // colliders that disappeared since the last step
+        for (auto it = leaves.begin(); it != leaves.end(); ) {
+            if (nodes[it->second].stamp != stamp) { nodes[it->second].dirty = stamp; removeLeaf(it->second); freeNode(it->second); it = leaves.erase(it); }
+            else ++it;
+        }
+        // pairs between two untouched leaves still overlap exactly as before
+        leafPairs.erase(remove_if(leafPairs.begin(), leafPairs.end(), [&](const LeafPair &lp){ return nodes[lp.a].dirty == stamp || nodes[lp.b].dirty == stamp; }), leafPairs.end());
+        for (int m: moved) {
+            query(nodes[m].box, [&](int leaf){
+                if (leaf == m || (nodes[leaf].dirty == stamp && leaf < m)) return; // a pair of two moved leaves is found once
+                const Node &x = nodes[m], &y = nodes[leaf];
+                if (!(x.isStatic && y.isStatic) && layersInteract(x.category, x.mask, y.category, y.mask)) leafPairs.push_back({ min(m, leaf), max(m, leaf) });
+            });
+        }
+        for (auto &lp: leafPairs) { uint32_t i = nodes[lp.a].proxy, j = nodes[lp.b].proxy; pairs.push_back({ min(i, j), max(i, j) }); }
+        sortPairs(pairs);
+    }
+    void queryBox(const AABB &box, vector<uint32_t> &out) override { query(box, [&](int leaf){ out.push_back(nodes[leaf].proxy); }); }
+    int height() const { return root < 0 ? 0 : nodes[root].height; }
+private:
+    // Leaves also keep their proxy's filter bits, so stored pairs stay valid without the proxies.
+    struct Node { AABB box; int parent=-1, left=-1, right=-1, height=0; uint32_t proxy=0, stamp=0, dirty=0; bool isStatic=false; uint32_t category=0, mask=0; bool leaf() const { return left < 0; } };
+    struct LeafPair { int a, b; };
+
+    static AABB combine(const AABB &a, const AABB &b){ preal x0=min(a.x,b.x), y0=min(a.y,b.y); return { x0, y0, max(a.x+a.w, b.x+b.w)-x0, max(a.y+a.h, b.y+b.h)-y0 }; }
+    static preal perimeter(const AABB &a){ return 2*(a.w + a.h); }
+    static bool contains(const AABB &o, const AABB &i){ return o.x <= i.x && o.y <= i.y && i.x+i.w <= o.x+o.w && i.y+i.h <= o.y+o.h; }
+    AABB fatten(const AABB &a) const { return { a.x-margin, a.y-margin, a.w+2*margin, a.h+2*margin }; }
+
+    int allocNode(){
+        int n;
+        if (freeList >= 0) { n = freeList; freeList = nodes[n].parent; nodes[n] = Node(); }
+        else { n = (int)nodes.size(); nodes.emplace_back(); }
+        return n;
+    }
+    void freeNode(int n){ nodes[n].parent = freeList; nodes[n].height = -1; freeList = n; }
+
+    void insertLeaf(int leaf){
+        if (root < 0) { root = leaf; nodes[leaf].parent = -1; return; }
+        AABB lb = nodes[leaf].box; int idx = root;
+        // descend towards the cheapest sibling: creating a parent here costs 2*combined, pushing the
+        // leaf further down costs the growth of this node plus the growth of the chosen child
+        while (!nodes[idx].leaf()) {
+            int l = nodes[idx].left, r = nodes[idx].right;
+            preal combined = perimeter(combine(nodes[idx].box, lb));
+            preal cost = 2*combined, inherit = 2*(combined - perimeter(nodes[idx].box));
+            auto childCost = [&](int c){ preal grown = perimeter(combine(lb, nodes[c].box)); return (nodes[c].leaf() ? grown : grown - perimeter(nodes[c].box)) + inherit; };
+            preal costL = childCost(l), costR = childCost(r);
+            if (cost < costL && cost < costR) break;
+            idx = costL < costR ? l : r;
+        }
+        int sibling = idx, oldParent = nodes[sibling].parent, np = allocNode();
+        nodes[np].parent = oldParent; nodes[np].box = combine(lb, nodes[sibling].box); nodes[np].height = nodes[sibling].height + 1;
+        if (oldParent >= 0) { if (nodes[oldParent].left == sibling) nodes[oldParent].left = np; else nodes[oldParent].right = np; }
+        else root = np;
+        nodes[np].left = sibling; nodes[np].right = leaf; nodes[sibling].parent = np; nodes[leaf].parent = np;
+        refit(nodes[leaf].parent);
+    }
+    void removeLeaf(int leaf){
+        if (leaf == root) { root = -1; return; }
+        int parent = nodes[leaf].parent, grand = nodes[parent].parent;
+        int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+        nodes[sibling].parent = grand;
+        if (grand >= 0) { if (nodes[grand].left == parent) nodes[grand].left = sibling; else nodes[grand].right = sibling; freeNode(parent); refit(grand); }
+        else { root = sibling; freeNode(parent); }
+    }
+    void refit(int idx){
+        while (idx >= 0) {
+            idx = balance(idx);
+            Node &n = nodes[idx];
+            n.height = 1 + max(nodes[n.left].height, nodes[n.right].height);
+            n.box = combine(nodes[n.left].box, nodes[n.right].box);
+            idx = n.parent;
+        }
+    }
+    // Rotates the taller grandchild up when A's subtrees differ in height by more than one.
+    int balance(int iA){
+        Node &A = nodes[iA];
+        if (A.leaf() || A.height < 2) return iA;
+        int iB = A.left, iC = A.right; Node &B = nodes[iB], &C = nodes[iC];
+        int bal = C.height - B.height;
+        if (bal > 1) {
+            int iF = C.left, iG = C.right; Node &F = nodes[iF], &G = nodes[iG];
+            C.left = iA; C.parent = A.parent; A.parent = iC;
+            if (C.parent >= 0) { if (nodes[C.parent].left == iA) nodes[C.parent].left = iC; else nodes[C.parent].right = iC; }
+            else root = iC;
+            if (F.height > G.height) { C.right = iF; A.right = iG; G.parent = iA; A.box = combine(B.box, G.box); C.box = combine(A.box, F.box); A.height = 1 + max(B.height, G.height); C.height = 1 + max(A.height, F.height); }
+            else { C.right = iG; A.right = iF; F.parent = iA; A.box = combine(B.box, F.box); C.box = combine(A.box, G.box); A.height = 1 + max(B.height, F.height); C.height = 1 + max(A.height, G.height); }
+            return iC;
+        }
+        if (bal < -1) {
+            int iD = B.left, iE = B.right; Node &D = nodes[iD], &E = nodes[iE];
+            B.left = iA; B.parent = A.parent; A.parent = iB;
+            if (B.parent >= 0) { if (nodes[B.parent].left == iA) nodes[B.parent].left = iB; else nodes[B.parent].right = iB; }
+            else root = iB;
+            if (D.height > E.height) { B.right = iD; A.left = iE; E.parent = iA; A.box = combine(C.box, E.box); B.box = combine(A.box, D.box); A.height = 1 + max(C.height, E.height); B.height = 1 + max(A.height, D.height); }
+            else { B.right = iE; A.left = iD; D.parent = iA; A.box = combine(C.box, D.box); B.box = combine(A.box, E.box); A.height = 1 + max(C.height, D.height); B.height = 1 + max(A.height, E.height); }
+            return iB;
+        }
+        return iA;
+    }
+    template<typename F> void query(const AABB &box, F &&fn){
+        if (root < 0) return;
+        stack.clear(); stack.push_back(root);
+        while (!stack.empty()) {
+            int n = stack.back(); stack.pop_back();
+            if (!aabbIntersect(nodes[n].box, box)) continue;
+            if (nodes[n].leaf()) fn(n);
+            else { stack.push_back(nodes[n].left); stack.push_back(nodes[n].right); }
+        }
+    }
+
+    preal margin;
+    vector<Node> nodes; int root = -1, freeList = -1; uint32_t stamp = 0;
+    unordered_map<uint64_t, int> leaves; // entity id -> leaf node
+    vector<int> stack, moved; // moved: leaves reinserted this step
+    vector<LeafPair> leafPairs; // fat-box overlaps, persistent across steps
+};
+
+// Persistent sweep-and-prune. Min/max endpoints of every box are kept sorted on both axes between
+// steps and re-sorted with insertion sort, which is near O(N) when bodies move a little. Two boxes
+// can only start (stop) overlapping when a min endpoint passes a max endpoint (or the reverse),
+// so the overlap set is maintained from those swaps alone and reported as begin/end events.
+class SweepAndPruneBroadphase : public Broadphase {
+public:
+    const char* name() const override { return "sap"; }
+    void findPairs(const vector<BroadphaseProxy> &proxies, vector<BroadphasePair> &pairs) override {
+        began.clear(); ended.clear(); ++stamp;
+        bool refiltered = false; widest = 0;
+        for (uint32_t i=0; i<proxies.size(); ++i) {
+            const BroadphaseProxy &p = proxies[i]; widest = max(widest, p.box.w);
+            auto it = handles.find(p.id.id()); uint32_t h;
+            if (it == handles.end()) {
+                if (!freeSlots.empty()) { h = freeSlots.back(); freeSlots.pop_back(); } else { h = (uint32_t)slots.size(); slots.emplace_back(); }
+                handles.emplace(p.id.id(), h); slots[h].id = p.id; slots[h].fresh = true; fresh.push_back(h); added.push_back(h);
+            } else {
+                h = it->second; Slot &s = slots[h];
+                // filter bits changed: existing pairs may no longer interact and new ones may, so look the slot up again
+                if (s.isStatic != p.isStatic || s.category != p.category || s.mask != p.mask) { s.fresh = true; fresh.push_back(h); refiltered = true; }
+            }
+            slots[h].box = p.box; slots[h].proxy = i; slots[h].stamp = stamp; slots[h].isStatic = p.isStatic; slots[h].category = p.category; slots[h].mask = p.mask;
+        }
+        removeStale();
+        if (refiltered) dropFiltered();
+        for (int a=0; a<2; ++a) { sortAxis(a); mergeAdded(a); }
+        added.clear();
+        if (!fresh.empty()) sweepFresh();
+        pairs.clear();
+        for (uint64_t key: overlaps) { uint32_t a = slots[key >> 32].proxy, b = slots[(uint32_t)key].proxy; pairs.push_back({ min(a, b), max(a, b) }); }
+        sortPairs(pairs);
+    }
+    // Binary-searches the X-sorted endpoints for the box's left edge minus the widest proxy (no
+    // proxy starting further left can reach the box) and walks up to its right edge.
+    void queryBox(const AABB &box, vector<uint32_t> &out) override {
+        preal from = box.x - widest; if (from > box.x) from = -PrealMax; // Q16.16 subtraction wraps
+        auto first = lower_bound(axes[0].begin(), axes[0].end(), from, [](const Endpoint &e, preal v){ return e.v < v; });
+        for (auto it = first; it != axes[0].end(); ++it) { const Endpoint &e = *it;
+            if (e.v > box.x + box.w) break;
+            const Slot &s = slots[e.slot];
+            if (!e.isMax && s.box.x + s.box.w >= box.x && aabbIntersect(s.box, box)) out.push_back(s.proxy);
+        }
+    }
+    // Overlaps that started / stopped during the last findPairs.
+    const vector<EntityPair>& beginEvents() const { return began; }
+    const vector<EntityPair>& endEvents() const { return ended; }
+private:
+    struct Slot { Entity id; AABB box{}; uint32_t proxy = 0, stamp = 0; bool fresh = false, isStatic = false; uint32_t category = 0, mask = 0; };
+    struct Endpoint { preal v; uint32_t slot; bool isMax; };
+
+    // on ties mins sort first, matching aabbIntersect treating touching boxes as overlapping
+    static bool before(const Endpoint &l, const Endpoint &r){ return l.v < r.v || (l.v == r.v && !l.isMax && r.isMax); }
+    bool interact(uint32_t a, uint32_t b) const { const Slot &x = slots[a], &y = slots[b]; return !(x.isStatic && y.isStatic) && layersInteract(x.category, x.mask, y.category, y.mask); }
+    static uint64_t pairKey(uint32_t a, uint32_t b){ if (a > b) swap(a, b); return ((uint64_t)a << 32) | b; }
+    void addPair(uint32_t a, uint32_t b){ if (overlaps.insert(pairKey(a, b)).second) began.push_back({ slots[a].id, slots[b].id }); }
+    void removePair(uint32_t a, uint32_t b){ if (overlaps.erase(pairKey(a, b))) ended.push_back({ slots[a].id, slots[b].id }); }
+
+    void sortAxis(int a){
+        vector<Endpoint> &ep = axes[a];
+        for (auto &e: ep) { const AABB &b = slots[e.slot].box; e.v = a == 0 ? (e.isMax ? b.x + b.w : b.x) : (e.isMax ? b.y + b.h : b.y); }
+        for (size_t i=1; i<ep.size(); ++i) {
+            Endpoint cur = ep[i]; size_t j = i;
+            while (j > 0 && before(cur, ep[j-1])) {
+                const Endpoint &prev = ep[j-1];
+                if (cur.slot != prev.slot) {
+                    if (!cur.isMax && prev.isMax) { if (interact(cur.slot, prev.slot) && aabbIntersect(slots[cur.slot].box, slots[prev.slot].box)) addPair(cur.slot, prev.slot); }
+                    else if (cur.isMax && !prev.isMax) removePair(cur.slot, prev.slot);
+                }
+                ep[j] = prev; --j;
+            }
+            ep[j] = cur;
+        }
+    }
+    Endpoint endpoint(int a, uint32_t h, bool isMax) const {
+        const AABB &b = slots[h].box;
+        return { a == 0 ? (isMax ? b.x + b.w : b.x) : (isMax ? b.y + b.h : b.y), h, isMax };
+    }
+    // New proxies are sorted on their own and merged in one pass, so a bulk insert costs n log n instead of
+    // insertion-sorting each endpoint across the whole axis; their overlaps are found later by sweepFresh.
+    void mergeAdded(int a){
+        if (added.empty()) return;
+        vector<Endpoint> &ep = axes[a];
+        scratch.clear();
+        for (uint32_t h: added) { scratch.push_back(endpoint(a, h, false)); scratch.push_back(endpoint(a, h, true)); }
+        sort(scratch.begin(), scratch.end(), before);
+        size_t mid = ep.size();
+        ep.insert(ep.end(), scratch.begin(), scratch.end());
+        inplace_merge(ep.begin(), ep.begin() + mid, ep.end(), before);
+    }
+    // One sweep over the merged X axis; only pairs with at least one fresh slot are tested, the rest were
+    // kept up to date by the swaps in sortAxis.
+    void sweepFresh(){
+        activeAt.resize(slots.size());
+        vector<uint32_t> *lists[2] = { &active, &activeFresh };
+        for (const Endpoint &e: axes[0]) {
+            const Slot &s = slots[e.slot];
+            vector<uint32_t> &own = *lists[s.fresh];
+            if (e.isMax) {
+                uint32_t at = activeAt[e.slot]; own[at] = own.back(); activeAt[own[at]] = at; own.pop_back();
+                continue;
+            }
+            for (uint32_t o: activeFresh) if (interact(e.slot, o) && aabbIntersect(s.box, slots[o].box)) addPair(e.slot, o);
+            if (s.fresh) for (uint32_t o: active) if (interact(e.slot, o) && aabbIntersect(s.box, slots[o].box)) addPair(e.slot, o);
+            activeAt[e.slot] = (uint32_t)own.size(); own.push_back(e.slot);
+        }
+        for (uint32_t h: fresh) slots[h].fresh = false;
+        fresh.clear();
+    }
+    void dropFiltered(){
+        for (auto it = overlaps.begin(); it != overlaps.end(); ) {
+            uint32_t a = (uint32_t)(*it >> 32), b = (uint32_t)*it;
+            if ((slots[a].fresh || slots[b].fresh) && !interact(a, b)) { ended.push_back({ slots[a].id, slots[b].id }); it = overlaps.erase(it); }
+            else ++it;
+        }
+    }
+    void removeStale(){
+        bool any = false;
+        for (auto it = handles.begin(); it != handles.end(); ) {
+            if (slots[it->second].stamp == stamp) { ++it; continue; }
+            freeSlots.push_back(it->second); it = handles.erase(it); any = true;
+        }
+        if (!any) return;
+        for (auto &axis: axes) axis.erase(remove_if(axis.begin(), axis.end(), [&](const Endpoint &e){ return slots[e.slot].stamp != stamp; }), axis.end());
+        for (auto it = overlaps.begin(); it != overlaps.end(); ) {
+            uint32_t a = (uint32_t)(*it >> 32), b = (uint32_t)*it;
+            if (slots[a].stamp != stamp || slots[b].stamp != stamp) { ended.push_back({ slots[a].id, slots[b].id }); it = overlaps.erase(it); }
+            else ++it;
+        }
+    }
+
+    vector<Slot> slots; vector<uint32_t> freeSlots, fresh, added, active, activeFresh, activeAt; uint32_t stamp = 0;
+    vector<Endpoint> scratch;
+    preal widest = 0; // widest proxy of the last findPairs, bounds how far left queryBox starts
+    unordered_map<uint64_t, uint32_t> handles; // entity id -> slot
+    vector<Endpoint> axes[2];
+    unordered_set<uint64_t> overlaps;
+    vector<EntityPair> began, ended;
+};
+
+// physics.broadphase = grid | tree | sap | naive, physics.grid_cell = cell size in pixels,
+// physics.tree_margin = how far a body may move before its tree leaf is reinserted
+static unique_ptr<Broadphase> createBroadphase(const Config &cfg){
+    string kind = cfg.get("physics.broadphase", "grid");
+    if (kind == "naive") return make_unique<NaiveBroadphase>();
+    if (kind == "sap") return make_unique<SweepAndPruneBroadphase>();
+    if (kind == "tree") return make_unique<TreeBroadphase>(cfg.getFloat("physics.tree_margin", 8.0f));
+    if (kind != "grid") LOGW("Unknown physics.broadphase '%s', using grid", kind.c_str());
+    return make_unique<GridBroadphase>(cfg.getFloat("physics.grid_cell", 128.0f));
+}
+
+// ------------------------------ Physics Kernels ---------------------------
+// Integration over SoA columns: vy += g*dt; vx += ax*dt; vy += ay*dt; x += vx*dt; y += vy*dt.
+// All variants perform the same operations in the same order (no FMA contraction), so they
+// produce bit-identical results; the widest one the CPU supports is picked at startup. With
+// ENGINE_FIXED_POINT the columns are Q16.16 and the SIMD variants do integer multiplies instead.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ENGINE_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define ENGINE_TARGET(t) __attribute__((target(t)))
+#else
+#define ENGINE_TARGET(t)
+#endif
+#endif
+
+using IntegrateKernel = void(*)(size_t n, preal dt, preal *x, preal *y, preal *vx, preal *vy, const preal *ax, const preal *ay, const preal *g);
+
+static void integrateScalar(size_t n, preal dt, preal *x, preal *y, preal *vx, preal *vy, const preal *ax, const preal *ay, const preal *g){
+    for(size_t i=0;i<n;++i){ vy[i] += g[i]*dt; vx[i] += ax[i]*dt; vy[i] += ay[i]*dt; x[i] += vx[i]*dt; y[i] += vy[i]*dt; }
+}
+
+#if defined(ENGINE_X86) && !defined(ENGINE_FIXED_POINT)
+ENGINE_TARGET("sse2") static void integrateSSE(size_t n, float dt, float *x, float *y, float *vx, float *vy, const float *ax, const float *ay, const float *g){
+    __m128 d = _mm_set1_ps(dt); size_t i=0;
+    for(; i+4<=n; i+=4){
+        __m128 v_y = _mm_add_ps(_mm_loadu_ps(vy+i), _mm_mul_ps(_mm_loadu_ps(g+i), d));
+        __m128 v_x = _mm_add_ps(_mm_loadu_ps(vx+i), _mm_mul_ps(_mm_loadu_ps(ax+i), d));
+        v_y = _mm_add_ps(v_y, _mm_mul_ps(_mm_loadu_ps(ay+i), d));
+        _mm_storeu_ps(vx+i, v_x); _mm_storeu_ps(vy+i, v_y);
+        _mm_storeu_ps(x+i, _mm_add_ps(_mm_loadu_ps(x+i), _mm_mul_ps(v_x, d)));
+        _mm_storeu_ps(y+i, _mm_add_ps(_mm_loadu_ps(y+i), _mm_mul_ps(v_y, d)));
+    }
+    integrateScalar(n-i, dt, x+i, y+i, vx+i, vy+i, ax+i, ay+i, g+i);
+}
+
+ENGINE_TARGET("avx2") static void integrateAVX2(size_t n, float dt, float *x, float *y, float *vx, float *vy, const float *ax, const float *ay, const float *g){
+    __m256 d = _mm256_set1_ps(dt); size_t i=0;
+    for(; i+8<=n; i+=8){
+        __m256 v_y = _mm256_add_ps(_mm256_loadu_ps(vy+i), _mm256_mul_ps(_mm256_loadu_ps(g+i), d));
+        __m256 v_x = _mm256_add_ps(_mm256_loadu_ps(vx+i), _mm256_mul_ps(_mm256_loadu_ps(ax+i), d));
+        v_y = _mm256_add_ps(v_y, _mm256_mul_ps(_mm256_loadu_ps(ay+i), d));
+        _mm256_storeu_ps(vx+i, v_x); _mm256_storeu_ps(vy+i, v_y);
+        _mm256_storeu_ps(x+i, _mm256_add_ps(_mm256_loadu_ps(x+i), _mm256_mul_ps(v_x, d)));
+        _mm256_storeu_ps(y+i, _mm256_add_ps(_mm256_loadu_ps(y+i), _mm256_mul_ps(v_y, d)));
+    }
+    integrateSSE(n-i, dt, x+i, y+i, vx+i, vy+i, ax+i, ay+i, g+i);
+}
+#endif
+
+#if defined(ENGINE_X86) && defined(ENGINE_FIXED_POINT)
+// Q16.16 multiply of four lanes: _mm_mul_epi32 only multiplies the even lanes into 64-bit
+// products, so the odd lanes are shifted down and multiplied separately. The low 32 bits of
+// (p >> 16) don't depend on the sign fill, so a logical shift matches the scalar (int64)a*b >> 16.
+ENGINE_TARGET("sse4.1") static inline __m128i mulFixedSSE(__m128i a, __m128i b){
+    __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), Fixed::Shift);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), Fixed::Shift);
+    return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+}
+ENGINE_TARGET("avx2") static inline __m256i mulFixedAVX2(__m256i a, __m256i b){
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), Fixed::Shift);
+    __m256i odd = _mm256_srli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), Fixed::Shift);
+    return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+#define FIXED_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define FIXED_STORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define FIXED_LOAD8(p) _mm256_loadu_si256((const __m256i*)(p))
+#define FIXED_STORE8(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+ENGINE_TARGET("sse4.1") static void integrateSSE(size_t n, preal dt, preal *x, preal *y, preal *vx, preal *vy, const preal *ax, const preal *ay, const preal *g){
+    __m128i d = _mm_set1_epi32(dt.raw); size_t i=0;
+    for(; i+4<=n; i+=4){
+        __m128i v_y = _mm_add_epi32(FIXED_LOAD(vy+i), mulFixedSSE(FIXED_LOAD(g+i), d));
+        __m128i v_x = _mm_add_epi32(FIXED_LOAD(vx+i), mulFixedSSE(FIXED_LOAD(ax+i), d));
+        v_y = _mm_add_epi32(v_y, mulFixedSSE(FIXED_LOAD(ay+i), d));
+        FIXED_STORE(vx+i, v_x); FIXED_STORE(vy+i, v_y);
+        FIXED_STORE(x+i, _mm_add_epi32(FIXED_LOAD(x+i), mulFixedSSE(v_x, d)));
+        FIXED_STORE(y+i, _mm_add_epi32(FIXED_LOAD(y+i), mulFixedSSE(v_y, d)));
+    }
+    integrateScalar(n-i, dt, x+i, y+i, vx+i, vy+i, ax+i, ay+i, g+i);
+}
+
+ENGINE_TARGET("avx2") static void integrateAVX2(size_t n, preal dt, preal *x, preal *y, preal *vx, preal *vy, const preal *ax, const preal *ay, const preal *g){
+    __m256i d = _mm256_set1_epi32(dt.raw); size_t i=0;
+    for(; i+8<=n; i+=8){
+        __m256i v_y = _mm256_add_epi32(FIXED_LOAD8(vy+i), mulFixedAVX2(FIXED_LOAD8(g+i), d));
+        __m256i v_x = _mm256_add_epi32(FIXED_LOAD8(vx+i), mulFixedAVX2(FIXED_LOAD8(ax+i), d));
+        v_y = _mm256_add_epi32(v_y, mulFixedAVX2(FIXED_LOAD8(ay+i), d));
+        FIXED_STORE8(vx+i, v_x); FIXED_STORE8(vy+i, v_y);
+        FIXED_STORE8(x+i, _mm256_add_epi32(FIXED_LOAD8(x+i), mulFixedAVX2(v_x, d)));
+        FIXED_STORE8(y+i, _mm256_add_epi32(FIXED_LOAD8(y+i), mulFixedAVX2(v_y, d)));
+    }
+    integrateSSE(n-i, dt, x+i, y+i, vx+i, vy+i, ax+i, ay+i, g+i);
+}
+#endif
+
+static IntegrateKernel selectIntegrateKernel(const char **name){
+#ifdef ENGINE_X86
+    if(SDL_HasAVX2()){ *name = "AVX2"; return integrateAVX2; }
+#ifdef ENGINE_FIXED_POINT
+    if(SDL_HasSSE41()){ *name = "SSE4.1"; return integrateSSE; }
+#else
+    if(SDL_HasSSE2()){ *name = "SSE2"; return integrateSSE; }
+#endif
+#endif
+    *name = "scalar"; return integrateScalar;
+}
+
+// Batched AABB overlap over candidate pairs stored as SoA lanes (min/max corners of both boxes).
+// Each kernel appends the indices of overlapping pairs to `out` (which needs 16 slack entries)
+// and returns how many it wrote. Comparisons are `>=`, i.e. exactly !aabbIntersect's rejection
+// test, so every variant selects the same pairs as the scalar reference. Fixed-point builds
+// compare the raw Q16.16 lanes as signed integers.
+struct OverlapLanes {
+    vector<preal> ax0, ay0, ax1, ay1, bx0, by0, bx1, by1;
+    void resize(size_t n){ for(auto *v: { &ax0, &ay0, &ax1, &ay1, &bx0, &by0, &bx1, &by1 }) v->resize(n); }
+    void set(size_t i, const AABB &a, const AABB &b){ ax0[i] = a.x; ay0[i] = a.y; ax1[i] = a.x+a.w; ay1[i] = a.y+a.h; bx0[i] = b.x; by0[i] = b.y; bx1[i] = b.x+b.w; by1[i] = b.y+b.h; }
+    size_t size() const { return ax0.size(); }
+};
+
+using OverlapKernel = size_t(*)(const OverlapLanes &l, size_t i, size_t n, uint32_t *out);
+
+static size_t overlapScalar(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0;
+    for(; i<n; ++i){ out[k] = (uint32_t)i; k += l.ax1[i] >= l.bx0[i] && l.bx1[i] >= l.ax0[i] && l.ay1[i] >= l.by0[i] && l.by1[i] >= l.ay0[i]; }
+    return k;
+}
+
+#if defined(ENGINE_X86) && !defined(ENGINE_FIXED_POINT)
+ENGINE_TARGET("sse2") static size_t overlapSSE(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0;
+    for(; i+4<=n; i+=4){
+        __m128 m = _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&l.ax1[i]), _mm_loadu_ps(&l.bx0[i])), _mm_cmpge_ps(_mm_loadu_ps(&l.bx1[i]), _mm_loadu_ps(&l.ax0[i])));
+        m = _mm_and_ps(m, _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&l.ay1[i]), _mm_loadu_ps(&l.by0[i])), _mm_cmpge_ps(_mm_loadu_ps(&l.by1[i]), _mm_loadu_ps(&l.ay0[i]))));
+        int bits = _mm_movemask_ps(m);
+        for(int j=0; j<4; ++j){ out[k] = (uint32_t)(i+j); k += (bits >> j) & 1; }
+    }
+    return k + overlapScalar(l, i, n, out+k);
+}
+
+ENGINE_TARGET("avx2") static size_t overlapAVX2(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0;
+    for(; i+8<=n; i+=8){
+        __m256 m = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&l.ax1[i]), _mm256_loadu_ps(&l.bx0[i]), _CMP_GE_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&l.bx1[i]), _mm256_loadu_ps(&l.ax0[i]), _CMP_GE_OQ));
+        m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&l.ay1[i]), _mm256_loadu_ps(&l.by0[i]), _CMP_GE_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&l.by1[i]), _mm256_loadu_ps(&l.ay0[i]), _CMP_GE_OQ)));
+        int bits = _mm256_movemask_ps(m);
+        for(int j=0; j<8; ++j){ out[k] = (uint32_t)(i+j); k += (bits >> j) & 1; }
+    }
+    return k + overlapSSE(l, i, n, out+k);
+}
+
+// AVX-512 compares straight into a mask register and compress-stores the matching indices.
+ENGINE_TARGET("avx512f,popcnt") static size_t overlapAVX512(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0; const __m512i lane = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    for(; i+16<=n; i+=16){
+        __mmask16 m = _mm512_cmp_ps_mask(_mm512_loadu_ps(&l.ax1[i]), _mm512_loadu_ps(&l.bx0[i]), _CMP_GE_OQ);
+        m &= _mm512_cmp_ps_mask(_mm512_loadu_ps(&l.bx1[i]), _mm512_loadu_ps(&l.ax0[i]), _CMP_GE_OQ);
+        m &= _mm512_cmp_ps_mask(_mm512_loadu_ps(&l.ay1[i]), _mm512_loadu_ps(&l.by0[i]), _CMP_GE_OQ);
+        m &= _mm512_cmp_ps_mask(_mm512_loadu_ps(&l.by1[i]), _mm512_loadu_ps(&l.ay0[i]), _CMP_GE_OQ);
+        _mm512_mask_compressstoreu_epi32(out+k, m, _mm512_add_epi32(lane, _mm512_set1_epi32((int)i)));
+        k += _mm_popcnt_u32(m);
+    }
+    return k + overlapAVX2(l, i, n, out+k);
+}
+#endif
+
+#if defined(ENGINE_X86) && defined(ENGINE_FIXED_POINT)
+// a >= b  <=>  !(b > a): OR together the four rejection tests and keep the lanes left clear.
+ENGINE_TARGET("sse2") static size_t overlapSSE(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0;
+    for(; i+4<=n; i+=4){
+        __m128i r = _mm_or_si128(_mm_cmpgt_epi32(FIXED_LOAD(&l.bx0[i]), FIXED_LOAD(&l.ax1[i])), _mm_cmpgt_epi32(FIXED_LOAD(&l.ax0[i]), FIXED_LOAD(&l.bx1[i])));
+        r = _mm_or_si128(r, _mm_or_si128(_mm_cmpgt_epi32(FIXED_LOAD(&l.by0[i]), FIXED_LOAD(&l.ay1[i])), _mm_cmpgt_epi32(FIXED_LOAD(&l.ay0[i]), FIXED_LOAD(&l.by1[i]))));
+        int bits = ~_mm_movemask_ps(_mm_castsi128_ps(r));
+        for(int j=0; j<4; ++j){ out[k] = (uint32_t)(i+j); k += (bits >> j) & 1; }
+    }
+    return k + overlapScalar(l, i, n, out+k);
+}
+
+ENGINE_TARGET("avx2") static size_t overlapAVX2(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0;
+    for(; i+8<=n; i+=8){
+        __m256i r = _mm256_or_si256(_mm256_cmpgt_epi32(FIXED_LOAD8(&l.bx0[i]), FIXED_LOAD8(&l.ax1[i])), _mm256_cmpgt_epi32(FIXED_LOAD8(&l.ax0[i]), FIXED_LOAD8(&l.bx1[i])));
+        r = _mm256_or_si256(r, _mm256_or_si256(_mm256_cmpgt_epi32(FIXED_LOAD8(&l.by0[i]), FIXED_LOAD8(&l.ay1[i])), _mm256_cmpgt_epi32(FIXED_LOAD8(&l.ay0[i]), FIXED_LOAD8(&l.by1[i]))));
+        int bits = ~_mm256_movemask_ps(_mm256_castsi256_ps(r));
+        for(int j=0; j<8; ++j){ out[k] = (uint32_t)(i+j); k += (bits >> j) & 1; }
+    }
+    return k + overlapSSE(l, i, n, out+k);
+}
+
+ENGINE_TARGET("avx512f,popcnt") static size_t overlapAVX512(const OverlapLanes &l, size_t i, size_t n, uint32_t *out){
+    size_t k=0; const __m512i lane = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    for(; i+16<=n; i+=16){
+        __mmask16 m = _mm512_cmp_epi32_mask(_mm512_loadu_si512(&l.ax1[i]), _mm512_loadu_si512(&l.bx0[i]), _MM_CMPINT_NLT);
+        m &= _mm512_cmp_epi32_mask(_mm512_loadu_si512(&l.bx1[i]), _mm512_loadu_si512(&l.ax0[i]), _MM_CMPINT_NLT);
+        m &= _mm512_cmp_epi32_mask(_mm512_loadu_si512(&l.ay1[i]), _mm512_loadu_si512(&l.by0[i]), _MM_CMPINT_NLT);
+        m &= _mm512_cmp_epi32_mask(_mm512_loadu_si512(&l.by1[i]), _mm512_loadu_si512(&l.ay0[i]), _MM_CMPINT_NLT);
+        _mm512_mask_compressstoreu_epi32(out+k, m, _mm512_add_epi32(lane, _mm512_set1_epi32((int)i)));
+        k += _mm_popcnt_u32(m);
+    }
+    return k + overlapAVX2(l, i, n, out+k);
+}
+#endif
+
+static OverlapKernel selectOverlapKernel(const char **name){
+#ifdef ENGINE_X86
+#if SDL_VERSION_ATLEAST(2,0,12)
+    if(SDL_HasAVX512F()){ *name = "AVX-512"; return overlapAVX512; }
+#endif
+    if(SDL_HasAVX2()){ *name = "AVX2"; return overlapAVX2; }
+    if(SDL_HasSSE2()){ *name = "SSE2"; return overlapSSE; }
+#endif
+    *name = "scalar"; return overlapScalar;
+}
+
+// Narrowphase filter: gathers the boxes of every candidate pair into lanes, runs the overlap
+// kernel and keeps the pairs that touch, in candidate order. Given a job system, chunks of
+// candidates are packed and tested in parallel, each thread appending to its own buffer; the
+// buffers are merged and sorted by pair, which restores candidate order exactly, so the result
+// is the same for any worker count. Scratch is reused across steps.
+class Narrowphase {
+public:
+    OverlapKernel kernel = overlapScalar;
+    void findContacts(const vector<BroadphaseProxy> &proxies, const vector<BroadphasePair> &candidates, vector<BroadphasePair> &contacts, JobSystem *jobs = nullptr){
+        lanes.resize(candidates.size()); contacts.clear();
+        buffers.resize(jobs ? jobs->workerCount() + 1 : 1);
+        for(auto &b: buffers) b.contacts.clear();
+        auto generate = [&](size_t begin, size_t end){
+            for(size_t i=begin; i<end; ++i) lanes.set(i, proxies[candidates[i].a].box, proxies[candidates[i].b].box);
+            Buffer &buf = buffers[jobs ? JobSystem::threadSlot() : 0];
+            buf.hits.resize(end - begin + 16);
+            size_t n = kernel(lanes, begin, end, buf.hits.data());
+            for(size_t i=0; i<n; ++i) buf.contacts.push_back(candidates[buf.hits[i]]);
+        };
+        if(jobs) jobs->parallelFor(0, candidates.size(), 2048, generate); else generate(0, candidates.size());
+        for(auto &b: buffers) contacts.insert(contacts.end(), b.contacts.begin(), b.contacts.end());
+        if(buffers.size() > 1) sortPairs(contacts);
+    }
+private:
+    struct Buffer { vector<BroadphasePair> contacts; vector<uint32_t> hits; };
+    OverlapLanes lanes;
+    vector<Buffer> buffers; // one per thread slot
+};
+
 // ------------------------------ Renderer Utilities ------------------------
 static void drawRect(SDL_Renderer* r, int x,int y,int w,int h){ SDL_Rect rr={x,y,w,h}; SDL_RenderFillRect(r,&rr); }
 
+// Everything render() reads from the simulation, captured at the end of a fixed step. The
+// renderer never touches the World, so the two may run on different threads. Each entry also
+// carries its state before the step (px, py, prot) for interpolation.
+struct RenderSnapshot {
+    struct SpriteDraw { Texture *texture; SDL_Rect src; bool centered; float layer; uint32_t order; float x, y, rot, sx, sy, px, py, prot; };
+    vector<SpriteDraw> sprites;
+    vector<Particle> particles;
+    bool hasTarget = false; float targetX = 0, targetY = 0, prevTargetX = 0, prevTargetY = 0; // camera follows this
+    // Copy of the tile grid (row-major), re-copied only when Tilemap::version() moved past tileVersion.
+    vector<int> tiles; int tileRows = 0, tileCols = 0, tileW = 0, tileH = 0; uint64_t tileVersion = ~0ull; Texture *tileTexture = nullptr;
+    size_t entityCount = 0;
+    TimePoint published;
+};
+
+// Accumulates textured quads and draws each run of quads sharing a texture with a single
+// SDL_RenderGeometry call, so draw calls scale with texture switches rather than sprites.
+// Submit sprites grouped by texture: a texture change flushes. Quads with rot == 0 skip the
+// trig. Before SDL 2.0.18 (no RenderGeometry) every quad is its own SDL_RenderCopyEx.
+class SpriteBatcher {
+public:
+    void begin(SDL_Renderer *r){ renderer = r; current = nullptr; batches = 0; verts.clear(); indices.clear(); }
+    // (x, y, w, h): destination rect before rotation; rot in degrees, clockwise about its centre.
+    void draw(Texture *tex, const SDL_Rect &src, float x, float y, float w, float h, float rot){
+#if SDL_VERSION_ATLEAST(2,0,18)
+        if(tex != current){ flush(); current = tex; }
+        float u0 = (float)src.x / tex->w, v0 = (float)src.y / tex->h, u1 = (float)(src.x + src.w) / tex->w, v1 = (float)(src.y + src.h) / tex->h;
+        int base = (int)verts.size();
+        if(rot == 0){
+            verts.push_back(vertex(x, y, u0, v0)); verts.push_back(vertex(x + w, y, u1, v0));
+            verts.push_back(vertex(x + w, y + h, u1, v1)); verts.push_back(vertex(x, y + h, u0, v1));
+        } else {
+            float rad = rot * 0.017453292f, c = cosf(rad), s = sinf(rad), cx = x + w*0.5f, cy = y + h*0.5f, hw = w*0.5f, hh = h*0.5f;
+            auto corner = [&](float dx, float dy, float u, float v){ verts.push_back(vertex(cx + dx*c - dy*s, cy + dx*s + dy*c, u, v)); };
+            corner(-hw, -hh, u0, v0); corner(hw, -hh, u1, v0); corner(hw, hh, u1, v1); corner(-hw, hh, u0, v1);
+        }
+        for(int i: { 0, 1, 2, 2, 3, 0 }) indices.push_back(base + i);
+#else
+        SDL_Rect dst{ (int)x, (int)y, (int)w, (int)h }; SDL_RenderCopyEx(renderer, tex->tex, &src, &dst, rot, nullptr, SDL_FLIP_NONE); batches++;
+#endif
+    }
+    void end(){ flush(); current = nullptr; }
+    int batchCount() const { return batches; }
+private:
+#if SDL_VERSION_ATLEAST(2,0,18)
+    static SDL_Vertex vertex(float x, float y, float u, float v){ SDL_Vertex vx; vx.position = { x, y }; vx.color = { 255, 255, 255, 255 }; vx.tex_coord = { u, v }; return vx; }
+    vector<SDL_Vertex> verts;
+#endif
+    void flush(){
+#if SDL_VERSION_ATLEAST(2,0,18)
+        if(!indices.empty()) { SDL_RenderGeometry(renderer, current->tex, verts.data(), (int)verts.size(), indices.data(), (int)indices.size()); batches++; }
+        verts.clear(); indices.clear();
+#endif
+    }
+    SDL_Renderer *renderer = nullptr; Texture *current = nullptr; int batches = 0;
+    vector<int> indices;
+};
+
+// Blends a snapshot entry's pre-step state (alpha 0) towards its post-step state (alpha 1);
+// rotation takes the shortest way round.
+static void lerpTransform(float alpha, float px, float py, float prot, float &x, float &y, float &rot){
+    if(alpha >= 1.0f) return;
+    x = px + (x - px)*alpha; y = py + (y - py)*alpha;
+    rot = prot + (fmodf(rot - prot + 540.0f, 360.0f) - 180.0f)*alpha;
+}
+
 // ------------------------------ Engine ------------------------------------
 class Engine {
 public:
     Engine(int w=1280,int h=720,const string &title="Advanced Engine") : screenW(w), screenH(h), windowTitle(title) {}
     bool init(){
+        if(config.load("engine.cfg")) LOGI("Loaded engine.cfg");
         if(SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO|SDL_INIT_TIMER) < 0){ LOGE("SDL_Init failed: %s", SDL_GetError()); return false; }
         int imgFlags = IMG_INIT_PNG|IMG_INIT_JPG; if(!(IMG_Init(imgFlags) & imgFlags)) LOGW("IMG_Init warning: %s", IMG_GetError());
         if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0){ LOGW("Mix_OpenAudio failed: %s", Mix_GetError()); audioAvailable=false; }
@@ -278,6 +1894,20 @@ public:
         world = make_unique<World>();
         audio = make_unique<AudioManager>();
         particles = make_unique<ParticleSystem>(2048);
+        // jobs.workers: -1 = one per spare core, 0 = deterministic single-threaded mode
+        int workers = config.getInt("jobs.workers", -1); if(workers < 0) workers = max(0, (int)thread::hardware_concurrency() - 1);
+        jobs = make_unique<JobSystem>(workers); LOGI("Job system: %d worker(s)", workers);
+        scheduler = make_unique<SystemScheduler>(*jobs);
+        registerSystems();
+        broadphase = createBroadphase(config); LOGI("Collision broadphase: %s", broadphase->name());
+        sleepVelocity = config.getFloat("physics.sleep_velocity", 10.0f); sleepTime = config.getFloat("physics.sleep_time", 0.5f);
+        hashLog = config.getInt("physics.hash_log", 0);
+        fixedDt = 1.0 / max(1, config.getInt("physics.rate", 60)); // rendering interpolates, so 30 Hz still looks smooth
+#ifdef ENGINE_FIXED_POINT
+        LOGI("Physics: Q16.16 fixed point (deterministic)");
+#endif
+        const char *overlap = ""; narrowphase.kernel = selectOverlapKernel(&overlap); LOGI("Narrowphase overlap kernel: %s", overlap);
+        const char *kernel = ""; integrateBodies = selectIntegrateKernel(&kernel); LOGI("Physics integration kernel: %s", kernel);
         inputMap.bind("left", SDL_SCANCODE_A); inputMap.bind("left", SDL_SCANCODE_LEFT);
         inputMap.bind("right", SDL_SCANCODE_D); inputMap.bind("right", SDL_SCANCODE_RIGHT);
         inputMap.bind("jump", SDL_SCANCODE_SPACE);
@@ -295,128 +1925,591 @@ public:
     }
 
     void createDemoScene(){
-        // Tilemap ground
-        int tileW=64,tileH=64;
-        for(int cx=0; cx<20; ++cx){
-            for(int cy=8; cy<12; ++cy){
-                int id = world->create();
-                auto t = make_shared<Transform>(); t->x = cx*tileW + tileW/2; t->y = cy*tileH + tileH/2; world->add(id,"transform",t);
-                auto s = make_shared<Sprite>(); s->tex = "tiles"; s->sw = tileW; s->sh = tileH; s->centered=true; world->add(id,"sprite",s);
-                auto c = make_shared<Collider>(); c->w = tileW; c->h = tileH; c->isStatic = true; world->add(id,"collider",c);
-            }
-        }
+        // Tilemap ground: collided and drawn straight from the grid, no per-tile entities
+        tilemap.tileW = 64; tilemap.tileH = 64; tilemap.resize(12, 20);
+        for(int cx=0; cx<20; ++cx) for(int cy=8; cy<12; ++cy) tilemap.set(cy, cx, 1);
+        if(config.get("physics.tiles", "cells") == "merged") buildTileColliders();
+        world->reserveEntities(16);
+        world->reserveComponents(TransformId, 16); world->reserveComponents(SpriteId, 16); world->reserveComponents(ColliderId, 16);
         // Player
-        int pid = world->create(); auto pt = make_shared<Transform>(); pt->x=100; pt->y=100; world->add(pid,"transform",pt);
-        auto ps = make_shared<AnimatedSprite>(); ps->tex = "player"; ps->sw=48; ps->sh=48; ps->centered=true; ps->anim.frameCount=4; ps->anim.frameTime=0.12f; world->add(pid,"sprite",ps);
-        auto ph = make_shared<Physics>(); ph->vx=0; ph->vy=0; world->add(pid,"physics",ph);
-        auto pc = make_shared<Collider>(); pc->w=40; pc->h=40; pc->isStatic=false; world->add(pid,"collider",pc);
-        auto scr = make_shared<Script>();
-        scr->onUpdate = [this, pid](int id,double dt){ // player control
-            auto tr = world->get<Transform>(pid,"transform"); auto ph = world->get<Physics>(pid,"physics"); auto spr = world->get<AnimatedSprite>(pid,"sprite"); if(!tr||!ph) return;
+        Entity pid = world->create(); Transform pt; pt.x=100; pt.y=100; world->add(pid,pt);
+        Sprite ps; ps.tex = "player"; ps.sw=48; ps.sh=48; ps.centered=true; world->add(pid,ps);
+        Animation pa; pa.frameCount=4; pa.frameTime=0.12f; world->add(pid,pa);
+        Physics ph; ph.vx=0; ph.vy=0; ph.canSleep=false; world->add(pid,ph); // input drives it directly
+        Collider pc; pc.w=40; pc.h=40; pc.isStatic=false; pc.ccd=true; pc.category=LayerPlayer; world->add(pid,pc);
+        Script scr;
+        scr.onUpdate = [this, pid](Entity id,double dt){ // player control
+            auto tr = world->get<Transform>(pid); auto ph = world->get<Physics>(pid); auto an = world->get<Animation>(pid); if(!tr||!ph) return;
             float speed = 240.0f; bool left = input.down(SDL_SCANCODE_LEFT) || input.down(SDL_SCANCODE_A); bool right = input.down(SDL_SCANCODE_RIGHT) || input.down(SDL_SCANCODE_D);
             if(left) ph->vx = -speed; else if(right) ph->vx = speed; else ph->vx = 0;
             if((input.down(SDL_SCANCODE_SPACE) || input.down(SDL_SCANCODE_W)) && ph->onGround){ ph->vy = -420.0f; ph->onGround=false; auto snd=resources->getSound("jump"); if(snd) audio->playSound(snd); }
             // animation
-            if(spr){ if(fabs(ph->vx) > 1.0f) spr->anim.frameTime = 0.12f; else spr->anim.frameTime = 0.4f; }
+            if(an){ if(pabs(ph->vx) > 1.0f) an->frameTime = 0.12f; else an->frameTime = 0.4f; }
         };
-        world->add(pid,"script",scr);
+        world->add(pid,scr);
 
         // Camera
-        int camId = world->create(); auto ct = make_shared<Transform>(); ct->x=0; ct->y=0; world->add(camId,"transform",ct); auto cc = make_shared<CameraComp>(); cc->lerp=0.12f; world->add(camId,"camera",cc);
+        Entity camId = world->create(); Transform ct; ct.x=0; ct.y=0; world->add(camId,ct); CameraComp cc; cc.lerp=0.12f; world->add(camId,cc);
 
-        // Collectible example
-        for(int i=0;i<5;i++){ int id = world->create(); auto t = make_shared<Transform>(); t->x = 400 + i*80; t->y = 200; world->add(id,"transform",t); auto s = make_shared<Sprite>(); s->tex = "tiles"; s->sw=32; s->sh=32; world->add(id,"sprite",s); auto c = make_shared<Collider>(); c->w=32; c->h=32; c->isStatic=false; world->add(id,"collider",c); auto scr2 = make_shared<Script>(); scr2->onUpdate = [this,id](int eid,double dt){}; world->add(id,"script",scr2); }
+        // Collectibles: triggers picked up by the player, handled for the whole batch of events at once
+        for(int i=0;i<5;i++){ Entity id = world->create(); Transform t; t.x = 400 + i*80; t.y = 200; world->add(id,t); Sprite s; s.tex = "tiles"; s.sw=32; s.sh=32; world->add(id,s); Collider c; c.w=32; c.h=32; c.isStatic=false; c.trigger=true; c.category=LayerCollectible; c.mask=LayerPlayer; world->add(id,c); }
+        onTriggerEvents([this, pid](const vector<TriggerEvent> &events){
+            for(auto &ev: events){ if(ev.phase != TriggerPhase::Begin || !(ev.other == pid)) continue;
+                auto col = world->get<Collider>(ev.trigger); if(!col || !(col->category & LayerCollectible)) continue;
+                if(auto t = world->get<Transform>(ev.trigger)) particles->emit(toFloat(t->x), toFloat(t->y), 24);
+                commands.destroy(ev.trigger);
+            }
+        });
 
         sceneStarted = true;
+        logPoolStats();
         if(audioAvailable){ auto bg = resources->getSound("bg"); if(bg) audio->playMusic(bg); }
     }
 
-    void run(){ running=true; const double fixedDt = 1.0/60.0; const double maxAccum = 0.25; double accumulator=0.0; while(running){ TimePoint frameStart = chrono::steady_clock::now(); input.update(); if(input.quit) running=false; double now = chrono::duration_cast<ms>(chrono::steady_clock::now().time_since_epoch()).count(); chrono::duration<double> frameTime = chrono::steady_clock::now() - lastTime; lastTime = chrono::steady_clock::now(); accumulator += frameTime.count(); if(accumulator > maxAccum) accumulator = maxAccum; while(accumulator >= fixedDt){ fixedUpdate(fixedDt); accumulator -= fixedDt; } render(); // frame cap if not vsync
+    // physics.thread = 1 (default): scripts and physics step on a simulation thread that
+    // publishes a RenderSnapshot per step, while this thread only polls input and renders the
+    // newest snapshot, so a slow step no longer delays presenting. 0: both alternate here.
+    void run(){ running=true; const double maxAccum = 0.25; double accumulator=0.0; bool threaded = config.getInt("physics.thread", 1) != 0;
+        thread simThread; if(threaded){ LOGI("Simulation thread: on"); simThread = thread([this]{ simulate(); }); }
+        while(running){ TimePoint frameStart = chrono::steady_clock::now();
+            if(threaded){ frameInput.update(); if(frameInput.quit) running=false; inputs.back() = frameInput; inputs.publish(); render(AlphaFromClock); }
+            else { input.update(); if(input.quit) running=false; chrono::duration<double> frameTime = chrono::steady_clock::now() - lastTime; lastTime = chrono::steady_clock::now(); accumulator += frameTime.count(); if(accumulator > maxAccum) accumulator = maxAccum; while(accumulator >= fixedDt){ fixedUpdate(fixedDt); accumulator -= fixedDt; } render((float)(accumulator / fixedDt)); }
+            // frame cap if not vsync
             if(!vsync){ TimePoint frameEnd = chrono::steady_clock::now(); chrono::duration<double,milli> elapsed = frameEnd - frameStart; double targetMs = 1000.0/60.0; if(elapsed.count() < targetMs) SDL_Delay((Uint32)(targetMs - elapsed.count())); }
         }
+        if(simThread.joinable()) simThread.join();
         cleanup(); }
 
+    // Simulation thread: fixed steps against its own clock, each using the input the main thread
+    // published last. Sleeps until the next step is due rather than spinning.
+    void simulate(){ const double maxAccum = 0.25; double accumulator = 0.0; TimePoint last = chrono::steady_clock::now();
+        while(running){
+            TimePoint t = chrono::steady_clock::now(); accumulator = min(maxAccum, accumulator + chrono::duration<double>(t - last).count()); last = t;
+            if(accumulator < fixedDt){ this_thread::sleep_for(chrono::duration<double>(fixedDt - accumulator)); continue; }
+            if(inputs.acquire()) input = inputs.front();
+            while(accumulator >= fixedDt){ fixedUpdate(fixedDt); accumulator -= fixedDt; }
+        }
+    }
+
+    // Trigger events of the last physics step, in (trigger, other) order. Handlers run once per
+    // step from the script system with the whole batch; structural changes go through `commands`.
+    const vector<TriggerEvent>& triggerEvents() const { return triggers; }
+    // Hash of all body positions/velocities after the last fixed step (see hashBodies); compare
+    // it between peers or against a recording to catch desyncs on the step they happen.
+    uint64_t stepHash() const { return worldHash; }
+    void onTriggerEvents(function<void(const vector<TriggerEvent>&)> fn){ triggerHandlers.push_back(move(fn)); }
+    // Velocity changes from scripts. Unlike writing Physics directly, these wake a sleeping body
+    // (integration skips sleepers, so a plain write would be ignored until something touched it).
+    void setVelocity(Entity e, float vx, float vy){ world->wake(e); if(auto ph = world->get<Physics>(e)){ ph->vx = vx; ph->vy = vy; ph->restTime = 0; } }
+    void applyImpulse(Entity e, float ix, float iy){ world->wake(e);
+        if(auto ph = world->get<Physics>(e)){ preal m = ph->mass; if(m <= preal(0.0f)) m = 1.0f; ph->vx = ph->vx + preal(ix) / m; ph->vy = ph->vy + preal(iy) / m; ph->restTime = 0; } }
+
+    // Spatial queries over the broadphase, seeing colliders as of the last collision pass. Meant
+    // for scripts and systems, i.e. the thread that steps the simulation: with physics.thread=1
+    // that is not the main thread, which must not call these (render() only sees the
+    // RenderSnapshot). Results go to caller-owned vectors, which are cleared first,
+    // and nothing is allocated once those and the internal scratch have grown. With per-cell tile
+    // collision the solid tiles answer too, on LayerTiles, as a single Entity{} hit.
+    size_t overlapBox(const AABB &box, vector<Entity> &out, const QueryFilter &filter = {}){
+        out.clear(); gatherQuery(box, filter);
+        for(uint32_t i: queryScratch) if(aabbIntersect(queryProxy(i).box, box)) out.push_back(queryProxy(i).id);
+        if(queryTiles(filter) && closestTile(box, toFloat(box.x), toFloat(box.y)) >= 0) out.push_back(Entity{});
+        return out.size();
+    }
+    size_t overlapPoint(float x, float y, vector<Entity> &out, const QueryFilter &filter = {}){ return overlapBox({ x, y, 0, 0 }, out, filter); }
+    // Closest collider hit by the segment (x0,y0)-(x1,y1).
+    bool raycast(float x0, float y0, float x1, float y1, RayHit &hit, const QueryFilter &filter = {}){
+        float dx = x1 - x0, dy = y1 - y0; bool found = false; hit.t = 2.0f;
+        gatherQuery({ min(x0, x1), min(y0, y1), fabsf(dx), fabsf(dy) }, filter);
+        for(uint32_t i: queryScratch){ float t, nx, ny;
+            if(segmentAABB(x0, y0, dx, dy, queryProxy(i).box, t, nx, ny) && t < hit.t){ hit = { queryProxy(i).id, t, x0 + dx*t, y0 + dy*t, nx, ny }; found = true; }
+        }
+        if(queryTiles(filter) && raycastTiles(x0, y0, dx, dy, hit)) found = true;
+        return found;
+    }
+    // Up to k colliders nearest to (x,y) within maxDist (distance to the box, 0 inside), closest
+    // first. The search box grows from 64px until it holds k colliders, reaches maxDist or
+    // already covers every collider (and the tilemap), so a large maxDist costs no extra passes.
+    // Solid tiles count as one Entity{} at the distance of the closest cell.
+    size_t nearest(float x, float y, size_t k, float maxDist, vector<Entity> &out, const QueryFilter &filter = {}){
+        out.clear(); if(k == 0) return 0;
+        bool tiles = queryTiles(filter); float mapW = (float)(tilemap.cols*tilemap.tileW), mapH = (float)(tilemap.rows*tilemap.tileH);
+        for(float r = min(64.0f, maxDist); ; r = min(r*2.0f, maxDist)){
+            AABB box = { x - r, y - r, 2*r, 2*r };
+            size_t seen = gatherQuery(box, filter); nearestScratch.clear();
+            // a box holding every candidate is the last pass, so it accepts anything within maxDist
+            bool coversAll = seen == proxies.size() + resting.size() && (!tiles || (x - r <= 0 && y - r <= 0 && x + r >= mapW && y + r >= mapH));
+            float lim = coversAll ? maxDist : r;
+            for(uint32_t i: queryScratch){ const AABB &b = queryProxy(i).box; float bx = toFloat(b.x), by = toFloat(b.y);
+                float ddx = max(max(bx - x, 0.0f), x - toFloat(b.x + b.w)), ddy = max(max(by - y, 0.0f), y - toFloat(b.y + b.h)), d2 = ddx*ddx + ddy*ddy;
+                if(d2 <= lim*lim) nearestScratch.push_back({ d2, i });
+            }
+            if(tiles){ float d2 = closestTile(box, x, y); if(d2 >= 0 && d2 <= lim*lim) nearestScratch.push_back({ d2, TileHit }); }
+            if(nearestScratch.size() >= k || r >= maxDist || coversAll) break;
+        }
+        size_t n = min(k, nearestScratch.size());
+        partial_sort(nearestScratch.begin(), nearestScratch.begin() + n, nearestScratch.end());
+        for(size_t i=0; i<n; ++i){ uint32_t p = nearestScratch[i].second; out.push_back(p == TileHit ? Entity{} : queryProxy(p).id); }
+        return n;
+    }
+
 private:
-    void fixedUpdate(double dt){ // update scripts, physics integration
-        // scripts
-        for(auto id : world->all()){
-            auto sc = world->get<Script>(id,"script"); if(sc && sc->onUpdate) sc->onUpdate(id, dt); }
-        // integrate physics
-        for(auto id: world->all()){
-            auto ph = world->get<Physics>(id,"physics"); auto tr = world->get<Transform>(id,"transform"); if(ph && tr){ ph->vy += ph->gravity * dt; ph->vx += ph->ax * dt; ph->vy += ph->ay * dt; tr->x += ph->vx * dt; tr->y += ph->vy * dt; } }
-        // collision detection/resolution
-        collisionSolve();
-        // animations
-        for(auto id: world->all()){
-            auto an = world->get<AnimatedSprite>(id,"sprite"); if(an){ an->anim.timer += dt; if(an->anim.timer >= an->anim.frameTime){ an->anim.timer = 0; an->anim.current = (an->anim.current + 1) % max(1, an->anim.frameCount); } } }
-        // update particle system
-        particles->update(dt);
-    }
-
-    void collisionSolve(){ auto &ents = world->all(); // naive O(N^2)
-        for(size_t i=0;i<ents.size();++i){ int a = ents[i]; auto ac = world->get<Collider>(a,"collider"); auto at = world->get<Transform>(a,"transform"); if(!ac||!at) continue; AABB aa = { at->x - ac->w/2.0f + ac->offx, at->y - ac->h/2.0f + ac->offy, ac->w, ac->h };
-            for(size_t j=i+1;j<ents.size();++j){ int b = ents[j]; auto bc = world->get<Collider>(b,"collider"); auto bt = world->get<Transform>(b,"transform"); if(!bc||!bt) continue; AABB bb = { bt->x - bc->w/2.0f + bc->offx, bt->y - bc->h/2.0f + bc->offy, bc->w, bc->h };
-                if(aabbIntersect(aa,bb)){
-                    resolveCollision(a,b,aa,bb);
-                }
+    // Fixed-step systems in their logical order. The scheduler derives the dependency graph
+    // from the declared access: scripts and the final flush are exclusive, integration and
+    // collisions are chained through Transform/Physics, while animation and particles run
+    // alongside physics.
+    void registerSystems(){
+        scheduler->add({ "scripts", AccessAll, AccessAll, true, [this](double dt){ runScripts(dt); } });
+        scheduler->add({ "integrate", 0, access<Transform, Physics>(), false, [this](double dt){ integrate(dt); } });
+        scheduler->add({ "collisions", access<Collider>(), access<Transform, Physics>(), false, [this](double dt){ collisionSolve(dt); } });
+        scheduler->add({ "animation", 0, access<Animation>(), false, [this](double dt){ animate(dt); } });
+        scheduler->add({ "particles", 0, resourceAccess(ResourceParticles), false, [this](double dt){
+            jobs->parallelFor(0, particles->capacity(), 512, [&](size_t b, size_t e){ particles->update(dt, b, e); }); } });
+        scheduler->add({ "flush", AccessAll, AccessAll, true, [this](double){ commands.flush(*world); } });
+    }
+
+    void fixedUpdate(double dt){ snapshotTransforms(); scheduler->run(dt); publishSnapshot(); worldHash = hashBodies(); ++stepIndex;
+        if(hashLog > 0 && stepIndex % hashLog == 0) LOGI("Step %llu world hash %016llx", (unsigned long long)stepIndex, (unsigned long long)worldHash); }
+
+    // Remembers every Transform as it was before this step, by entity slot; render blends from it.
+    // Sleeping bodies don't move, so their part of the prefix is only re-read after the world's
+    // structure (or the set of sleepers) changed.
+    void snapshotTransforms(){
+        auto &tp = world->pool<Transform>(); const auto &ids = tp.entities();
+        auto snap = [&](size_t from, size_t to){ for(size_t i=from; i<to; ++i){ Entity e = ids[i]; auto t = tp.at(i);
+            if(e.index >= prevTransforms.size()) prevTransforms.resize(e.index + 1);
+            prevTransforms[e.index] = { e, toFloat(t.x), toFloat(t.y), t.rot }; } };
+        bool all = world->version() != snapshotVersion; snapshotVersion = world->version();
+        snap(0, all ? ids.size() : world->awakeBodyCount());
+        if(!all) snap(world->bodyCount(), ids.size());
+    }
+    // (x, y, rot) of `id` before this step; entities created during the step have no snapshot
+    // and keep the current values passed in, so they are drawn where they are.
+    void previousTransform(Entity id, float &x, float &y, float &rot) const {
+        if(id.index >= prevTransforms.size() || !(prevTransforms[id.index].id == id)) return;
+        const PrevTransform &p = prevTransforms[id.index]; x = p.x; y = p.y; rot = p.rot;
+    }
+
+    // Captures what render() needs after a step and hands it to the render thread.
+    void publishSnapshot(){ RenderSnapshot &snap = snapshots.back(); snap.sprites.clear(); snap.hasTarget = false;
+        for(Entity id: world->view<Sprite, Transform>()){ Sprite *sp = world->get<Sprite>(id);
+            if(!sp->textureResolved){ auto tex = resources->getTexture(sp->tex); sp->texture = tex.get(); sp->textureResolved = true; }
+            Texture *tex = sp->texture; if(!tex) continue; auto tr = world->get<Transform>(id); float x = toFloat(tr->x), y = toFloat(tr->y);
+            RenderSnapshot::SpriteDraw d{ tex, { sp->sx, sp->sy, sp->sw?sp->sw:tex->w, sp->sh?sp->sh:tex->h }, sp->centered, sp->layer, (uint32_t)snap.sprites.size(), x, y, tr->rot, tr->sx, tr->sy, x, y, tr->rot };
+            previousTransform(id, d.px, d.py, d.prot); snap.sprites.push_back(d); }
+        // by layer, then texture so the batcher gets long runs, then view order. Textures are keyed by
+        // load order rather than address, so within a layer sprites of an earlier-loaded texture
+        // always draw below later ones and overlaps come out the same on every run.
+        sort(snap.sprites.begin(), snap.sprites.end(), [](const RenderSnapshot::SpriteDraw &l, const RenderSnapshot::SpriteDraw &r){
+            if(l.layer != r.layer) return l.layer < r.layer;
+            if(l.texture->loadOrder != r.texture->loadOrder) return l.texture->loadOrder < r.texture->loadOrder;
+            return l.order < r.order; });
+        for(Entity id: world->view<Transform, Physics>()){ auto tr = world->get<Transform>(id); float rot = 0; // camera target: first entity with physics
+            snap.targetX = snap.prevTargetX = toFloat(tr->x); snap.targetY = snap.prevTargetY = toFloat(tr->y); previousTransform(id, snap.prevTargetX, snap.prevTargetY, rot); snap.hasTarget = true; break; }
+        if(!tileTextureResolved){ tileTexture = resources->getTexture("tiles").get(); tileTextureResolved = true; }
+        if(snap.tileVersion != tilemap.version()){ tilemap.copyTo(snap.tiles); snap.tileRows = tilemap.rows; snap.tileCols = tilemap.cols; snap.tileVersion = tilemap.version(); }
+        snap.tileW = tilemap.tileW; snap.tileH = tilemap.tileH; snap.tileTexture = tileTexture;
+        particles->snapshot(snap.particles);
+        snap.entityCount = world->all().size(); snap.published = chrono::steady_clock::now();
+        snapshots.publish();
+    }
+
+    // FNV-1a over every body's id and the raw bits of its position and velocity, in packed order.
+    // Two runs fed the same inputs agree on it every step iff they are in lockstep; only the
+    // fixed-point build makes that hold across compilers and CPUs. The sleeping part of the prefix
+    // is hashed separately and cached until the world's structure changes, then folded in.
+    uint64_t hashBodies(){
+        auto &tp = world->pool<Transform>(); auto &pp = world->pool<Physics>();
+        auto hashRange = [&](size_t from, size_t to, uint64_t h){
+            auto mix = [&](uint32_t v){ for(int i=0;i<4;++i){ h ^= (v >> (i*8)) & 0xff; h *= 1099511628211ull; } };
+            auto bits = [](preal v){ uint32_t u; memcpy(&u, &v, sizeof u); return u; };
+            for(size_t i=from; i<to; ++i){ Entity e = tp.entities()[i]; auto t = tp.at(i); auto p = pp.at(i);
+                mix(e.index); mix(e.gen); mix(bits(t.x)); mix(bits(t.y)); mix(bits(p.vx)); mix(bits(p.vy)); }
+            return h;
+        };
+        if(world->version() != sleepHashVersion){ sleepHash = hashRange(world->awakeBodyCount(), world->bodyCount(), 1469598103934665603ull); sleepHashVersion = world->version(); }
+        return hashRange(0, world->awakeBodyCount(), sleepHash);
+    }
+
+    void runScripts(double dt){ // structural changes made from onUpdate go through `commands` and are applied after the loop
+        world->each<Script>([&](Entity id, Script &sc){ if(sc.onUpdate) sc.onUpdate(id, dt); });
+        for(auto &h: triggerHandlers) h(triggers);
+        commands.flush(*world);
+    }
+
+    // Bodies are the packed Transform+Physics prefix, so chunk c of every column holds the same
+    // entities; each job streams whole chunks through the selected SIMD kernel. Sleeping bodies
+    // sit past the awake part of the prefix and are not touched at all.
+    void integrate(double dt){
+        size_t n = world->awakeBodyCount(); const size_t CS = ChunkedStorage<float>::ChunkSize;
+        auto &tc = world->pool<Transform>().columns(); auto &pc = world->pool<Physics>().columns();
+        jobs->parallelFor(0, (n + CS - 1) / CS, 4, [&](size_t b, size_t e){ for(size_t c=b;c<e;++c){
+            integrateBodies(min(CS, n - c*CS), (float)dt, tc.x.chunk(c), tc.y.chunk(c), pc.vx.chunk(c), pc.vy.chunk(c), pc.ax.chunk(c), pc.ay.chunk(c), pc.gravity.chunk(c)); } });
+    }
+
+    void animate(double dt){
+        auto &anims = world->pool<Animation>();
+        jobs->parallelFor(0, anims.size(), 512, [&](size_t b, size_t e){ for(size_t i=b;i<e;++i){ Animation &an = anims.at(i);
+            an.timer += dt; if(an.timer >= an.frameTime){ an.timer = 0; an.current = (an.current + 1) % max(1, an.frameCount); } } });
+    }
+
+    // Collider owners taking part in a collision pass, gathered once so the pair loop works on
+    // cached pointers instead of looking components up per pair.
+    // fixed: static or asleep, i.e. not moved by resolution.
+    struct Body { Entity id; Collider* col; RefPtr<TransformRef> tr; RefPtr<PhysicsRef> ph; bool asleep = false, fixed = false; };
+
+    static AABB colliderBox(preal x, preal y, const Collider &c){ return { x - c.w/2.0f + c.offx, y - c.h/2.0f + c.offy, c.w, c.h }; }
+    static AABB bodyBox(const Body &b){ return colliderBox(b.tr->x, b.tr->y, *b.col); }
+    static bool sameBox(const AABB &a, const AABB &b){ return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h; }
+
+    // Two phases: contact generation (broadphase candidates filtered by the batched narrowphase,
+    // in parallel) produces a sorted contact list from the boxes at the start of the pass, then
+    // resolution walks it serially in that order, so results don't depend on thread count.
+    // Each contact is re-tested against the current boxes since earlier resolutions may have
+    // moved the bodies.
+    // Only the awake part of the body prefix and the colliders without Physics are gathered;
+    // sleeping bodies stay in the resting tree and join the pass only when a pair reaches them,
+    // so a settled pile costs nothing per step beyond what touches it.
+    void collisionSolve(double dt){ auto &physics = world->pool<Physics>(); auto &transforms = world->pool<Transform>();
+        bodies.clear(); proxies.clear();
+        if(world->version() != restingVersion){ refreshResting(); restingVersion = world->version(); }
+        const auto &ids = transforms.entities();
+        for(size_t i=0, n=world->awakeBodyCount(); i<n; ++i){ Entity id = ids[i]; if(Collider *col = world->get<Collider>(id)) bodies.push_back({ id, col, transforms.get(id), physics.get(id), false, col->isStatic }); }
+        for(Entity id: looseColliders){ Collider *col = world->get<Collider>(id); bodies.push_back({ id, col, transforms.get(id), {}, false, col->isStatic }); }
+        refreshSolids();
+        for(auto &b: bodies) if(b.col->ccd && !b.fixed && !b.col->trigger && b.ph) sweepBody(b, (float)dt);
+        for(auto &b: bodies) proxies.push_back({ b.id, bodyBox(b), b.col->isStatic, b.col->category, b.col->mask });
+        size_t active = proxies.size();
+        queryScratch.reserve(active + resting.size()); nearestScratch.reserve(active + resting.size()); // queries return each proxy at most once
+        broadphase->findPairs(proxies, pairs);
+        addRestingPairs();
+        wakeUnsupported();
+        // nothing to resolve between two bodies that won't move (static and/or sleeping), unless one is a trigger
+        pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](const BroadphasePair &p){ const Body &a = bodies[p.a], &b = bodies[p.b]; return a.fixed && b.fixed && !a.col->trigger && !b.col->trigger; }), pairs.end());
+        narrowphase.findContacts(proxies, pairs, contacts, jobs.get());
+        triggerOverlaps.clear();
+        for(auto &p: contacts){ Body &a = bodies[p.a], &b = bodies[p.b];
+            if(a.col->trigger || b.col->trigger){ if(a.col->trigger != b.col->trigger) triggerOverlaps.push_back(a.col->trigger ? EntityPair{ a.id, b.id } : EntityPair{ b.id, a.id }); continue; }
+            AABB aa = bodyBox(a), bb = bodyBox(b);
+            if(aabbIntersect(aa,bb)){
+                resolveCollision(a,b,aa,bb);
             }
         }
+        if(tileCollision && tilemap.rows > 0) for(auto &b: bodies) if(!b.fixed && !b.col->trigger && layersInteract(b.col->category, b.col->mask, LayerTiles, LayerAll)) collideTiles(b);
+        updateTriggerEvents();
+        updateSleep((float)dt);
+        proxies.resize(active); // sleepers pulled into the pass are answered from `resting` by queries
     }
 
-    struct AABB { float x,y,w,h; };
-    static bool aabbIntersect(const AABB &a, const AABB &b){ return !(a.x+a.w < b.x || b.x+b.w < a.x || a.y+a.h < b.y || b.y+b.h < a.y); }
+    // Sleeping bodies never move and change only with sleep/wake, so their proxies live in a tree
+    // rebuilt (incrementally) when the world's structure changes, rather than in every pass. The
+    // same scan collects the Transform owners past the body prefix that have a Collider: the
+    // static, kinematic and trigger colliders without Physics.
+    void refreshResting(){ auto &transforms = world->pool<Transform>(); const auto &ids = transforms.entities();
+        resting.clear(); looseColliders.clear();
+        for(size_t i=world->awakeBodyCount(), n=world->bodyCount(); i<n; ++i){ Entity id = ids[i]; Collider *col = world->get<Collider>(id); if(!col) continue;
+            auto tr = transforms.get(id); resting.push_back({ id, colliderBox(tr->x, tr->y, *col), true, col->category, col->mask }); } // static to the tree: sleepers never pair among themselves
+        for(size_t i=world->bodyCount(); i<ids.size(); ++i) if(world->has<Collider>(ids[i])) looseColliders.push_back(ids[i]);
+        restingTree.findPairs(resting, restingPairs);
+        restingSlot.assign(resting.size(), -1);
+    }
+    // Candidate pairs between this pass and the sleepers: every gathered collider that could wake a
+    // sleeper or report it (anything not static, and static triggers) queries the resting tree.
+    // A sleeper found this way is appended to bodies/proxies as a fixed, asleep body.
+    void addRestingPairs(){
+        if(resting.empty()) return;
+        auto &physics = world->pool<Physics>(); auto &transforms = world->pool<Transform>(); size_t n = proxies.size(), before = pairs.size();
+        for(uint32_t i=0; i<n; ++i){ if(bodies[i].col->isStatic && !bodies[i].col->trigger) continue;
+            restingHits.clear(); restingTree.queryBox(proxies[i].box, restingHits);
+            for(uint32_t r: restingHits){ const BroadphaseProxy &s = resting[r];
+                if(!layersInteract(proxies[i].category, proxies[i].mask, s.category, s.mask)) continue;
+                int &at = restingSlot[r];
+                if(at < 0){ at = (int)proxies.size(); restingTouched.push_back(r); bodies.push_back({ s.id, world->get<Collider>(s.id), transforms.get(s.id), physics.get(s.id), true, true }); proxies.push_back(s); }
+                pairs.push_back({ i, (uint32_t)at });
+            }
+        }
+        for(uint32_t r: restingTouched) restingSlot[r] = -1;
+        restingTouched.clear();
+        if(pairs.size() != before) sortPairs(pairs);
+    }
+    // Static solid colliders of this pass, compared in gather order with the last pass's. When they
+    // differ, the static tree (what CCD sweeps query) is brought up to date and, if something
+    // sleeps, a sorted diff by entity finds the destroyed or moved ones and leaves their old boxes
+    // in `vanished`; unchanged statics cost one linear compare.
+    void refreshSolids(){
+        solids.clear();
+        for(auto &b: bodies) if(b.col->isStatic && !b.col->trigger) solids.push_back({ b.id, bodyBox(b), true, b.col->category, b.col->mask });
+        bool changed = solids.size() != lastSolids.size();
+        for(size_t i=0; !changed && i<solids.size(); ++i) changed = !(solids[i].id == lastSolids[i].id) || !sameBox(solids[i].box, lastSolids[i].box);
+        if(!changed) return;
+        staticTree.findPairs(solids, staticPairs);
+        if(!resting.empty()){
+            auto byId = [](const BroadphaseProxy &l, const BroadphaseProxy &r){ return l.id.id() < r.id.id(); };
+            sortedSolids = solids; sort(sortedSolids.begin(), sortedSolids.end(), byId); sort(lastSolids.begin(), lastSolids.end(), byId);
+            for(size_t i=0, j=0; j<lastSolids.size(); ++j){
+                while(i < sortedSolids.size() && sortedSolids[i].id.id() < lastSolids[j].id.id()) ++i;
+                bool kept = i < sortedSolids.size() && sortedSolids[i].id == lastSolids[j].id && sameBox(sortedSolids[i].box, lastSolids[j].box);
+                if(!kept) vanished.push_back(lastSolids[j].box);
+            }
+        }
+        lastSolids = solids;
+    }
+
+    // Sleeping bodies are not resolved, so one resting on a static collider or tile that goes away
+    // would hang in the air. refreshSolids leaves the old boxes of destroyed or moved statics in
+    // `vanished`, tile cells cleared through Tilemap::set add theirs, and sleepers touching any of
+    // them are woken by updateSleep.
+    void wakeUnsupported(){
+        if(!resting.empty()) for(auto &c: tilemap.clearedCells()) vanished.push_back({ (float)(c.col*tilemap.tileW), (float)(c.row*tilemap.tileH), (float)tilemap.tileW, (float)tilemap.tileH });
+        tilemap.clearedCells().clear();
+        for(auto &v: vanished){ AABB box = { v.x - 1.0f, v.y - 1.0f, v.w + 2.0f, v.h + 2.0f }; // resting contacts only touch
+            restingHits.clear(); restingTree.queryBox(box, restingHits);
+            for(uint32_t r: restingHits) if(aabbIntersect(resting[r].box, box)) wakers.push_back(resting[r].id);
+        }
+        vanished.clear();
+    }
 
-    void resolveCollision(int aid, int bid, AABB &aa, AABB &bb){ auto ac = world->get<Collider>(aid,"collider"); auto at = world->get<Transform>(aid,"transform"); auto ap = world->get<Physics>(aid,"physics"); auto bc = world->get<Collider>(bid,"collider"); auto bt = world->get<Transform>(bid,"transform"); auto bp = world->get<Physics>(bid,"physics"); if(!ac||!at||!bc||!bt) return;
-        float axc = aa.x + aa.w*0.5f; float ayc = aa.y + aa.h*0.5f; float bxc = bb.x + bb.w*0.5f; float byc = bb.y + bb.h*0.5f; float dx = bxc - axc; float dy = byc - ayc; float overlapX = (aa.w+bb.w)/2.0f - fabs(dx); float overlapY = (aa.h+bb.h)/2.0f - fabs(dy);
+    // Collects proxies of the last pass near box into queryScratch: the broadphase's, then the
+    // sleepers', numbered after them (see queryProxy). Returns how many were reported before filtering.
+    size_t gatherQuery(const AABB &box, const QueryFilter &filter){
+        queryScratch.clear(); if(!broadphase) return 0;
+        broadphase->queryBox(box, queryScratch); size_t base = queryScratch.size();
+        restingTree.queryBox(box, queryScratch);
+        for(size_t i=base; i<queryScratch.size(); ++i) queryScratch[i] += (uint32_t)proxies.size();
+        size_t seen = queryScratch.size();
+        queryScratch.erase(std::remove_if(queryScratch.begin(), queryScratch.end(), [&](uint32_t i){ const BroadphaseProxy &p = queryProxy(i); return !(p.category & filter.mask) || p.id == filter.ignore; }), queryScratch.end());
+        return seen;
+    }
+    const BroadphaseProxy& queryProxy(uint32_t i) const { return i < proxies.size() ? proxies[i] : resting[i - proxies.size()]; }
+
+    // Tiles only answer queries when they are collided per cell; merged ones are ordinary colliders.
+    bool queryTiles(const QueryFilter &filter) const { return tileCollision && tilemap.rows > 0 && (filter.mask & LayerTiles); }
+    static constexpr uint32_t TileHit = UINT32_MAX; // nearestScratch entry standing for the tilemap
+    // Squared distance from (x,y) to the closest solid cell touching box (0 inside one), or -1
+    // when there is none. Scans the cells under box, clamped to the map.
+    float closestTile(const AABB &box, float x, float y) const {
+        int tw = tilemap.tileW, th = tilemap.tileH; float best = -1.0f;
+        int c0 = max(0, floorDiv(box.x, tw)), c1 = min(tilemap.cols - 1, floorDiv(box.x + box.w, tw)), r0 = max(0, floorDiv(box.y, th)), r1 = min(tilemap.rows - 1, floorDiv(box.y + box.h, th));
+        for(int r=r0; r<=r1; ++r) for(int c=c0; c<=c1; ++c){ if(!tilemap.solid(r,c)) continue;
+            float ddx = max(max((float)(c*tw) - x, 0.0f), x - (float)((c+1)*tw)), ddy = max(max((float)(r*th) - y, 0.0f), y - (float)((r+1)*th)), d2 = ddx*ddx + ddy*ddy;
+            if(best < 0 || d2 < best) best = d2;
+        }
+        return best;
+    }
+    // Walks the cells the segment crosses in order (Amanatides-Woo grid traversal), clipped to the
+    // map, and takes the first solid one if it is closer than hit. Touching counts as a hit, as
+    // for colliders, so the neighbours of each visited cell are tested too: a segment along a
+    // grid line or through a corner touches cells the walk itself never enters.
+    bool raycastTiles(float x0, float y0, float dx, float dy, RayHit &hit) const {
+        float tw = (float)tilemap.tileW, th = (float)tilemap.tileH, t, nx, ny; bool found = false;
+        if(!segmentAABB(x0, y0, dx, dy, { 0.0f, 0.0f, tilemap.cols*tw, tilemap.rows*th }, t, nx, ny) || t >= hit.t) return false;
+        int c = min(max(floorDiv(x0 + dx*t, tilemap.tileW), 0), tilemap.cols - 1), r = min(max(floorDiv(y0 + dy*t, tilemap.tileH), 0), tilemap.rows - 1);
+        while(c >= 0 && c < tilemap.cols && r >= 0 && r < tilemap.rows){
+            for(int tr=r-1; tr<=r+1; ++tr) for(int tc=c-1; tc<=c+1; ++tc)
+                if(tilemap.solid(tr,tc) && segmentAABB(x0, y0, dx, dy, { tc*tw, tr*th, tw, th }, t, nx, ny) && t < hit.t){ hit = { Entity{}, t, x0 + dx*t, y0 + dy*t, nx, ny }; found = true; }
+            // t where the segment leaves this cell through its next column / row boundary
+            float tx = dx != 0 ? ((c + (dx > 0)) * tw - x0) / dx : INFINITY, ty = dy != 0 ? ((r + (dy > 0)) * th - y0) / dy : INFINITY;
+            if(min(tx, ty) > min(1.0f, hit.t)) break;
+            if(tx < ty) c += dx > 0 ? 1 : -1; else r += dy > 0 ? 1 : -1;
+        }
+        return found;
+    }
+
+    // Diffs this step's sorted trigger overlaps against the previous step's into Begin/Stay/End.
+    void updateTriggerEvents(){
+        auto less = [](const EntityPair &l, const EntityPair &r){ return l.a.id() < r.a.id() || (l.a.id() == r.a.id() && l.b.id() < r.b.id()); };
+        sort(triggerOverlaps.begin(), triggerOverlaps.end(), less);
+        triggers.clear(); size_t i = 0, j = 0;
+        while(i < triggerOverlaps.size() || j < lastTriggerOverlaps.size()){
+            if(j == lastTriggerOverlaps.size() || (i < triggerOverlaps.size() && less(triggerOverlaps[i], lastTriggerOverlaps[j]))){ triggers.push_back({ TriggerPhase::Begin, triggerOverlaps[i].a, triggerOverlaps[i].b }); i++; }
+            else if(i == triggerOverlaps.size() || less(lastTriggerOverlaps[j], triggerOverlaps[i])){ triggers.push_back({ TriggerPhase::End, lastTriggerOverlaps[j].a, lastTriggerOverlaps[j].b }); j++; }
+            else { triggers.push_back({ TriggerPhase::Stay, triggerOverlaps[i].a, triggerOverlaps[i].b }); i++; j++; }
+        }
+        swap(triggerOverlaps, lastTriggerOverlaps);
+    }
+
+    // Bodies (Transform+Physics+Collider) connected through contacts form islands; static
+    // geometry doesn't connect them. A body accumulates restTime while its speed stays under
+    // sleepVelocity, and an island goes to sleep once every member has rested for sleepTime.
+    // An awake body touching a sleeping one wakes it, as does losing static support (see
+    // wakeUnsupported) or setVelocity/applyImpulse. Sleeping bodies are skipped by
+    // integration and resolution and wait in the resting tree to be woken. Islands are built over
+    // the pass's bodies only, i.e. the awake ones plus sleepers they touch.
+    void updateSleep(preal dt){
+        if(sleepTime <= 0){ wakers.clear(); return; }
+        size_t n = bodies.size(); islands.resize(n); for(size_t i=0;i<n;++i) islands[i] = (int)i;
+        auto find = [&](int i){ while(islands[i] != i){ islands[i] = islands[islands[i]]; i = islands[i]; } return i; };
+        auto dynamic = [&](const Body &b){ return b.ph && !b.col->isStatic && !b.col->trigger; };
+        sleepers.clear(); // wakers may already hold bodies from wakeUnsupported
+        for(auto &p: contacts){ Body &a = bodies[p.a], &b = bodies[p.b];
+            if(!dynamic(a) || !dynamic(b) || (a.asleep && b.asleep)) continue;
+            if(a.asleep != b.asleep){ Body &s = a.asleep ? a : b, &w = a.asleep ? b : a; wakers.push_back(s.id); w.ph->restTime = 0; continue; }
+            islands[find(p.a)] = find(p.b);
+        }
+        islandRest.assign(n, PrealMax);
+        for(size_t i=0;i<n;++i){ Body &b = bodies[i]; if(!dynamic(b) || b.asleep) continue;
+            bool resting = b.ph->canSleep && speedWithin(b.ph->vx, b.ph->vy, sleepVelocity);
+            b.ph->restTime = resting ? b.ph->restTime + dt : 0.0f;
+            int r = find((int)i); islandRest[r] = min(islandRest[r], (preal)b.ph->restTime);
+        }
+        for(size_t i=0;i<n;++i){ Body &b = bodies[i]; if(!dynamic(b) || b.asleep || islandRest[find((int)i)] < sleepTime) continue;
+            b.ph->vx = 0; b.ph->vy = 0; sleepers.push_back(b.id); }
+        // sleep/wake reorder the Transform/Physics pools, so only now that the Body refs are done with
+        for(Entity e: sleepers) world->sleep(e);
+        for(Entity e: wakers){ world->wake(e); if(auto ph = world->get<Physics>(e)) ph->restTime = 0; }
+        wakers.clear();
+    }
+
+    // Continuous collision for bodies flagged ccd. Integration already moved the body by v*dt, so
+    // the sweep starts from where it came from and stops at the first static collider (found
+    // through the static tree) or solid tile in the way, then slides along it with the remaining
+    // motion. Without this a body
+    // moving more than its own size (or a tile) per step tunnels through.
+    void sweepBody(Body &a, preal dt){
+        AABB end = bodyBox(a); preal dx = a.ph->vx*dt, dy = a.ph->vy*dt;
+        AABB box = { end.x - dx, end.y - dy, end.w, end.h };
+        for(int iter=0; iter<2 && (dx != 0 || dy != 0); ++iter){
+            preal toi = 1.0f, nx = 0, ny = 0;
+            AABB swept = { min(box.x, box.x + dx), min(box.y, box.y + dy), box.w + pabs(dx), box.h + pabs(dy) };
+            auto test = [&](const AABB &obstacle){ preal t, tx, ty; if(sweepAABB(box, dx, dy, obstacle, t, tx, ty) && t < toi){ toi = t; nx = tx; ny = ty; } };
+            sweepHits.clear(); staticTree.queryBox(swept, sweepHits); sort(sweepHits.begin(), sweepHits.end()); // gather order breaks ties in toi
+            for(uint32_t h: sweepHits){ const BroadphaseProxy &s = solids[h]; if(layersInteract(a.col->category, a.col->mask, s.category, s.mask)) test(s.box); }
+            if(tileCollision && tilemap.rows > 0 && layersInteract(a.col->category, a.col->mask, LayerTiles, LayerAll)){ int tw = tilemap.tileW, th = tilemap.tileH;
+                int c0 = floorDiv(swept.x, tw), c1 = floorDiv(swept.x + swept.w, tw), r0 = floorDiv(swept.y, th), r1 = floorDiv(swept.y + swept.h, th);
+                for(int r=r0; r<=r1; ++r) for(int c=c0; c<=c1; ++c) if(tilemap.solid(r,c)) test({ (float)(c*tw), (float)(r*th), (float)tw, (float)th });
+            }
+            box.x += dx*toi; box.y += dy*toi;
+            if(toi >= 1.0f) break;
+            preal rest = 1.0f - toi;
+            if(nx != 0){ dx = 0; a.ph->vx = 0; } else { dy = 0; a.ph->vy = 0; if(ny < 0) a.ph->onGround = true; }
+            dx *= rest; dy *= rest;
+        }
+        a.tr->x += box.x - end.x; a.tr->y += box.y - end.y;
+    }
+
+    // Alternative to collideTiles for levels whose tiles must stay ordinary colliders: merge the
+    // solid cells into rectangles and spawn one static collider per rectangle.
+    void buildTileColliders(){ int tw = tilemap.tileW, th = tilemap.tileH, solidCount = 0;
+        for(int r=0; r<tilemap.rows; ++r) for(int c=0; c<tilemap.cols; ++c) solidCount += tilemap.solid(r,c);
+        auto rects = tilemap.mergeSolid();
+        for(auto &rc: rects){ Entity id = world->create();
+            Transform t; t.x = (rc.col + rc.cols*0.5f) * tw; t.y = (rc.row + rc.rows*0.5f) * th; world->add(id,t);
+            Collider c; c.w = (float)(rc.cols * tw); c.h = (float)(rc.rows * th); c.isStatic = true; c.category = LayerTiles; world->add(id,c);
+        }
+        tileCollision = false;
+        LOGI("Merged %d solid tiles into %zu static colliders", solidCount, rects.size());
+    }
+
+    // Resolves a dynamic body against the solid cells its box touches, treating each cell as a
+    // static collider: O(cells touched), independent of level size.
+    void collideTiles(Body &a){
+        Collider tileCol; tileCol.isStatic = true; Body tile{ Entity{}, &tileCol, {}, {}, false, true };
+        int tw = tilemap.tileW, th = tilemap.tileH; AABB aa = bodyBox(a);
+        int c0 = floorDiv(aa.x, tw), c1 = floorDiv(aa.x + aa.w, tw), r0 = floorDiv(aa.y, th), r1 = floorDiv(aa.y + aa.h, th);
+        for(int r=r0; r<=r1; ++r) for(int c=c0; c<=c1; ++c){
+            if(!tilemap.solid(r,c)) continue;
+            AABB tb = { (float)(c*tw), (float)(r*th), (float)tw, (float)th }; aa = bodyBox(a);
+            if(aabbIntersect(aa,tb)) resolveCollision(a,tile,aa,tb);
+        }
+    }
+
+    void resolveCollision(Body &a, Body &b, AABB &aa, AABB &bb){ auto &at = a.tr, &bt = b.tr; auto &ap = a.ph, &bp = b.ph;
+        preal axc = aa.x + aa.w*0.5f; preal ayc = aa.y + aa.h*0.5f; preal bxc = bb.x + bb.w*0.5f; preal byc = bb.y + bb.h*0.5f; preal dx = bxc - axc; preal dy = byc - ayc; preal overlapX = (aa.w+bb.w)/2.0f - pabs(dx); preal overlapY = (aa.h+bb.h)/2.0f - pabs(dy);
         if(overlapX < overlapY){ // resolve in X
-            float sign = dx>0?1.0f:-1.0f; if(!ac->isStatic && !bc->isStatic){ at->x -= sign * overlapX*0.5f; bt->x += sign * overlapX*0.5f; } else if(!ac->isStatic){ at->x -= sign * overlapX; } else if(!bc->isStatic){ bt->x += sign * overlapX; }
+            preal sign = dx>0?1.0f:-1.0f; if(!a.fixed && !b.fixed){ at->x -= sign * overlapX*0.5f; bt->x += sign * overlapX*0.5f; } else if(!a.fixed){ at->x -= sign * overlapX; } else if(!b.fixed){ bt->x += sign * overlapX; }
             if(ap) ap->vx = 0; if(bp) bp->vx = 0;
         } else { // resolve in Y
-            float sign = dy>0?1.0f:-1.0f; if(!ac->isStatic && !bc->isStatic){ at->y -= sign * overlapY*0.5f; bt->y += sign * overlapY*0.5f; } else if(!ac->isStatic){ at->y -= sign * overlapY; } else if(!bc->isStatic){ bt->y += sign * overlapY; }
+            preal sign = dy>0?1.0f:-1.0f; if(!a.fixed && !b.fixed){ at->y -= sign * overlapY*0.5f; bt->y += sign * overlapY*0.5f; } else if(!a.fixed){ at->y -= sign * overlapY; } else if(!b.fixed){ bt->y += sign * overlapY; }
             // set ground flags
             if(ap){ if(sign>0) ap->onGround = true; ap->vy = 0; }
             if(bp){ if(sign<0) bp->onGround = true; bp->vy = 0; }
         }
     }
 
-    void render(){ // clear
+    void renderTilemap(const RenderSnapshot &snap){ Texture *tex = snap.tileTexture; if(!tex || snap.tileRows == 0 || snap.tileW <= 0 || snap.tileH <= 0) return; int tw = snap.tileW, th = snap.tileH;
+        int c0 = max(0, (int)floorf(camX / tw)), c1 = min(snap.tileCols - 1, (int)floorf((camX + screenW) / tw)), r0 = max(0, (int)floorf(camY / th)), r1 = min(snap.tileRows - 1, (int)floorf((camY + screenH) / th));
+        SDL_Rect src{ 0, 0, tw, th };
+        for(int r=r0; r<=r1; ++r) for(int c=c0; c<=c1; ++c){ if(snap.tiles[(size_t)r*snap.tileCols + c] == 0) continue; batcher.draw(tex, src, (float)round(c*tw - camX), (float)round(r*th - camY), (float)tw, (float)th, 0); }
+    }
+
+    // alpha = accumulator / fixedDt: how far real time has run past the last fixed step. Moving
+    // things are drawn that fraction of the way from their previous step's state to the current
+    // one, so motion stays smooth at any refresh rate, at the cost of one step of latency.
+    // AlphaFromClock (simulation thread) derives it from how long ago the snapshot was published.
+    // Draws only from the newest RenderSnapshot, never from the World.
+    static constexpr float AlphaFromClock = -1.0f;
+    void render(float alpha = 1.0f){ snapshots.acquire(); const RenderSnapshot &snap = snapshots.front();
+        if(alpha < 0) alpha = (float)min(1.0, chrono::duration<double>(chrono::steady_clock::now() - snap.published).count() / fixedDt);
+        // clear
         SDL_SetRenderDrawColor(renderer, 18, 20, 24, 255); SDL_RenderClear(renderer);
         // camera transform
-        computeCamera();
-        // render sprites (no sorting for demo)
-        for(auto id: world->all()){
-            auto sp = world->get<Sprite>(id,"sprite"); auto tr = world->get<Transform>(id,"transform"); if(!sp || !tr) continue; auto tex = resources->getTexture(sp->tex); if(!tex) continue; SDL_Rect src{ sp->sx, sp->sy, sp->sw?sp->sw:tex->w, sp->sh?sp->sh:tex->h };
-                int dw = (int)(src.w * tr->sx); int dh = (int)(src.h * tr->sy); SDL_Rect dst{ (int)round(tr->x - camX - (sp->centered?dw/2.0f:0)), (int)round(tr->y - camY - (sp->centered?dh/2.0f:0)), dw, dh };
-                SDL_RenderCopyEx(renderer, tex->tex, &src, &dst, tr->rot, nullptr, SDL_FLIP_NONE);
+        computeCamera(snap, alpha);
+        batcher.begin(renderer);
+        renderTilemap(snap); // one batch for the visible tiles
+        // render sprites: the snapshot is sorted by layer and texture, so each run is one batch
+        for(auto &d: snap.sprites){
+            float x = d.x, y = d.y, rot = d.rot; lerpTransform(alpha, d.px, d.py, d.prot, x, y, rot);
+            int dw = (int)(d.src.w * d.sx); int dh = (int)(d.src.h * d.sy);
+            batcher.draw(d.texture, d.src, (float)round(x - camX - (d.centered?dw/2.0f:0)), (float)round(y - camY - (d.centered?dh/2.0f:0)), (float)dw, (float)dh, rot);
         }
+        batcher.end();
         // particles
-        particles->render(renderer, camX, camY);
+        ParticleSystem::render(renderer, snap.particles, camX, camY, alpha);
         // UI: render debug overlay
-        renderDebugOverlay();
+        renderDebugOverlay(snap);
         SDL_RenderPresent(renderer);
     }
 
-    void computeCamera(){ // follow first entity with physics
-        float targetX=0, targetY=0; bool found=false;
-        for(auto id: world->all()){ auto p = world->get<Physics>(id,"physics"); auto tr = world->get<Transform>(id,"transform"); if(p && tr){ targetX = tr->x - screenW/2.0f; targetY = tr->y - screenH/2.0f; found=true; break; } }
-        if(!found) return; camX += (targetX - camX) * 0.12f; camY += (targetY - camY) * 0.12f; }
+    void computeCamera(const RenderSnapshot &snap, float alpha = 1.0f){ // follow first entity with physics
+        if(!snap.hasTarget) return;
+        float x = snap.targetX, y = snap.targetY, rot = 0; lerpTransform(alpha, snap.prevTargetX, snap.prevTargetY, 0, x, y, rot);
+        float targetX = x - screenW/2.0f, targetY = y - screenH/2.0f;
+        camX += (targetX - camX) * 0.12f; camY += (targetY - camY) * 0.12f; }
 
-    void renderDebugOverlay(){ // simple FPS & stats
+    void renderDebugOverlay(const RenderSnapshot &snap){ // simple FPS & stats
         double t = nowMillis(); frameCount++; if(t - lastFPSTime >= 500.0){ fps = (frameCount*1000.0)/(t-lastFPSTime); frameCount=0; lastFPSTime=t; }
         // draw simple overlay box
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
         SDL_SetRenderDrawColor(renderer, 0,0,0,160); SDL_Rect box = {8,8,220,80}; SDL_RenderFillRect(renderer,&box);
         // use console logging for details
-        LOGI("FPS: %.1f | Entities: %zu | Textures: %zu", fps, world->all().size(), 0);
+        LOGI("FPS: %.1f | Entities: %zu | Sprites: %zu | Batches: %d", fps, snap.entityCount, snap.sprites.size(), batcher.batchCount());
+    }
+
+    void logPoolStats(){
+        vector<PoolStats> stats; world->poolStats(stats);
+        for(auto &st: stats){ if(!st.chunks && !st.freeChunks) continue;
+            LOGI("Pool %-10s %6zu / %-6zu (%zu chunks, %zu free, %zu KB) occupancy %.0f%% fragmentation %.0f%%", st.name, st.live, st.capacity, st.chunks, st.freeChunks, st.bytes/1024, st.occupancy()*100.0f, st.fragmentation()*100.0f); }
     }
 
-    void cleanup(){ resources.reset(); world.reset(); audio.reset(); particles.reset(); if(renderer){ SDL_DestroyRenderer(renderer); renderer=nullptr; } if(window){ SDL_DestroyWindow(window); window=nullptr; } Mix_CloseAudio(); IMG_Quit(); SDL_Quit(); }
+    void cleanup(){ scheduler.reset(); jobs.reset(); resources.reset(); world.reset(); audio.reset(); particles.reset(); if(renderer){ SDL_DestroyRenderer(renderer); renderer=nullptr; } if(window){ SDL_DestroyWindow(window); window=nullptr; } Mix_CloseAudio(); IMG_Quit(); SDL_Quit(); }
 
     int screenW, screenH; string windowTitle; SDL_Window* window=nullptr; SDL_Renderer* renderer=nullptr; unique_ptr<ResourceManager> resources; unique_ptr<World> world; unique_ptr<AudioManager> audio; unique_ptr<ParticleSystem> particles;
-    InputState input; InputMap inputMap;
-    bool running=false; bool vsync=true; bool audioAvailable=true; bool sceneStarted=false; TimePoint lastTime;
+    unique_ptr<JobSystem> jobs; unique_ptr<SystemScheduler> scheduler; Config config;
+    IntegrateKernel integrateBodies = integrateScalar;
+    InputState input; InputMap inputMap; // input: what the current step sees
+    InputState frameInput; TripleBuffer<InputState> inputs; // simulation thread: polled on the main thread, handed over per frame
+    TripleBuffer<RenderSnapshot> snapshots; // simulation -> render
+    SpriteBatcher batcher;
+    CommandBuffer commands; // deferred create/destroy/add/remove for code running inside systems
+    atomic<bool> running{false}; bool vsync=true; bool audioAvailable=true; bool sceneStarted=false; TimePoint lastTime;
+    vector<Body> bodies; vector<BroadphaseProxy> proxies; vector<BroadphasePair> pairs, contacts; // collision scratch, reused every step
+    unique_ptr<Broadphase> broadphase; Narrowphase narrowphase;
+    vector<uint32_t> queryScratch; vector<pair<float, uint32_t>> nearestScratch; // spatial query scratch
+    vector<EntityPair> triggerOverlaps, lastTriggerOverlaps; vector<TriggerEvent> triggers; vector<function<void(const vector<TriggerEvent>&)>> triggerHandlers;
+    vector<int> islands; vector<preal> islandRest; vector<Entity> sleepers, wakers; // sleep scratch
+    uint64_t snapshotVersion = ~0ull, sleepHash = 0, sleepHashVersion = ~0ull; // sleeping prefix, cached per world version
+    vector<BroadphaseProxy> solids, lastSolids, sortedSolids; vector<AABB> vanished; // static solids of this / the last pass
+    TreeBroadphase staticTree{ 0.0f }; vector<BroadphasePair> staticPairs; vector<uint32_t> sweepHits; // solids, for CCD sweeps
+    vector<BroadphaseProxy> resting; TreeBroadphase restingTree{ 0.0f }; vector<BroadphasePair> restingPairs; // sleeping bodies
+    vector<uint32_t> restingHits, restingTouched; vector<int> restingSlot; vector<Entity> looseColliders; uint64_t restingVersion = ~0ull;
+    preal sleepVelocity = 10.0f, sleepTime = 0.5f;
+    double fixedDt = 1.0/60.0; // physics.rate
+    struct PrevTransform { Entity id; float x, y, rot; }; vector<PrevTransform> prevTransforms; // render interpolation
+    uint64_t worldHash = 0; int hashLog = 0; uint64_t stepIndex = 0; // lockstep / replay checks
     // camera
     float camX=0, camY=0;
+    Tilemap tilemap; bool tileCollision = true; // false once the tiles are baked into colliders
+    Texture *tileTexture = nullptr; bool tileTextureResolved = false; // "tiles", looked up once by publishSnapshot
     // debug
     double fps=0; int frameCount=0; double lastFPSTime=nowMillis();
 };